@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingQueue.hpp"
+#include "Wait.hpp"
+#include <atomic>
+#include <coroutine>
+#include <concepts>
+#include <utility>
+#include <expected>
+#include <cassert>
+namespace rb {
+
+/// Anything with schedule(handle), which should eventually resume
+/// the handle, e.g. by pushing it onto a thread pool's run queue.
+template<typename E>
+concept Executor = requires(E exec, std::coroutine_handle<> handle) {
+  exec.schedule(handle);
+};
+
+/// Resumes the coroutine right away, on the thread that notified it.
+struct InlineExecutor {
+  auto schedule(std::coroutine_handle<> handle) const -> void {
+    handle.resume();
+  }
+};
+
+/// A wait policy that can also park one suspended coroutine, which is
+/// rescheduled on Exec by the next notify(). Threads blocked in
+/// wait() are handled by Park as usual, so the blocking operations
+/// keep working alongside the awaitable ones. Since only one side of
+/// a queue waits on any given instance, one slot is enough.
+/// wake() only wakes threads: a coroutine is only ever resumed once
+/// its condition is true, or by close() (see RingQueue::close()).
+
+template<Executor Exec = InlineExecutor, typename Park = BlockingWait>
+struct CoroutineWait : Park {
+  constexpr static bool process_shared_ = false;
+
+  /// Parks handle unless ready() turns out to be true after all.
+  /// Returns whether the coroutine stays suspended, as await_suspend()
+  /// would: if it doesn't, nothing will resume it later.
+  template<typename Pred>
+  auto park(std::coroutine_handle<> handle, Pred&& ready) -> bool {
+    parked_.store(handle.address(), std::memory_order::seq_cst);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if(!ready())
+      return true;
+
+    /// If notify() got there first it owns the handle now.
+    return parked_.exchange(nullptr, std::memory_order::acq_rel) == nullptr;
+  }
+
+  /// The fence pairs with the one in park(), as in close(): Park may
+  /// not have one of its own (BusySpinWait and YieldWait don't).
+  auto notify() -> void {
+    Park::notify();
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if(parked_.load(std::memory_order::relaxed) == nullptr)
+      return;
+
+    if(void* addr = parked_.exchange(nullptr, std::memory_order::acq_rel))
+      exec_.schedule(std::coroutine_handle<>::from_address(addr));
+  }
+
+  /// Reschedules the parked coroutine whether its condition holds
+  /// or not. Only for shutdown: the awaiters check for it themselves
+  /// and report RingStatus::closed, and since that's part of their
+  /// condition, nothing parks afterwards. The fence pairs with the
+  /// one in park(): either we see the handle, or it sees the flag.
+  auto close() -> void {
+    Park::wake();
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if(void* addr = parked_.exchange(nullptr, std::memory_order::acq_rel))
+      exec_.schedule(std::coroutine_handle<>::from_address(addr));
+  }
+
+  NO_UNIQUE_ADDRESS_ Exec exec_{};
+protected:
+  std::atomic<void*> parked_{ nullptr };
+};
+
+/// A RingQueue whose producer and consumer can also be coroutines:
+///   co_await queue.async_enqueue(v);
+///   auto v = co_await queue.async_dequeue();
+/// suspend instead of blocking the thread, and are rescheduled on
+/// the given executor by the other side. Either side may mix these
+/// with the regular (blocking or not) operations, but there's still
+/// only one producer and one consumer at a time. Both report close()
+/// as the timed operations do: async_enqueue() right away,
+/// async_dequeue() once the queue is drained. Park is what blocked
+/// threads use, see CoroutineWait.
+
+template<typename T, size_t size_, Executor Exec = InlineExecutor,
+  typename Layout = DefaultLayout, typename Park = BlockingWait>
+class AsyncRingQueue : public RingQueue<T, size_, CoroutineWait<Exec, Park>, Layout> {
+public:
+  using Base = RingQueue<T, size_, CoroutineWait<Exec, Park>, Layout>;
+  using Base::head_;
+  using Base::tail_;
+
+  using ValueType = T;
+
+  class EnqueueAwaiter {
+  public:
+    NODISCARD_ auto await_ready() -> bool {
+      lhead_ = queue_.producer_pos();
+      return queue_.is_closed() || queue_.has_room(lhead_);
+    }
+
+    auto await_suspend(std::coroutine_handle<> handle) -> bool {
+      return queue_.not_full_.park(handle, [this]{ return queue_.is_closed() || queue_.has_room(lhead_); });
+    }
+
+    /// Resumed by notify(), so there's room by now, but the cached
+    /// tail has to be brought up to date with it either way.
+    auto await_resume() -> std::expected<void, RingStatus> {
+      if(queue_.is_closed())
+        return std::unexpected(RingStatus::closed);
+
+      UNUSED_ const bool room = queue_.can_produce(lhead_);
+      assert(room);
+      queue_.construct(lhead_, std::move(val_));
+      if(queue_.publish_head(lhead_ + 1))
+        queue_.not_empty_.notify();
+      return {};
+    }
+
+    EnqueueAwaiter(AsyncRingQueue& queue, T&& val)
+      : queue_{ queue }, val_{ std::move(val) } {}
+  protected:
+    AsyncRingQueue& queue_;
+    T val_;
+    size_t lhead_{ 0 };
+  };
+
+  class DequeueAwaiter {
+  public:
+    NODISCARD_ auto await_ready() -> bool {
+      ltail_ = queue_.consumer_pos();
+      return queue_.can_consume(ltail_) || queue_.is_closed();
+    }
+
+    auto await_suspend(std::coroutine_handle<> handle) -> bool {
+      return queue_.not_empty_.park(handle, [this]{ return queue_.can_consume(ltail_) || queue_.is_closed(); });
+    }
+
+    auto await_resume() -> std::expected<T, RingStatus> {
+      if(!queue_.can_consume(ltail_)) {
+        assert(queue_.is_closed());
+        return std::unexpected(RingStatus::closed);
+      }
+
+      T val = queue_.take(ltail_);
+      if(queue_.publish_tail(ltail_ + 1))
+        queue_.not_full_.notify();
+      return val;
+    }
+
+    explicit DequeueAwaiter(AsyncRingQueue& queue) : queue_{ queue } {}
+  protected:
+    AsyncRingQueue& queue_;
+    size_t ltail_{ 0 };
+  };
+
+  /// The element is constructed from args right away and moved
+  /// into the queue once there's room for it.
+  template<typename ...Args>
+  NODISCARD_ auto async_enqueue(Args&&... args) -> EnqueueAwaiter {
+    static_assert(std::constructible_from<T, Args...>);
+    return EnqueueAwaiter{ *this, T(std::forward<Args>(args)...) };
+  }
+
+  NODISCARD_ auto async_dequeue() -> DequeueAwaiter {
+    return DequeueAwaiter{ *this };
+  }
+
+  explicit AsyncRingQueue(Exec exec = {}) {
+    this->not_empty_.exec_ = exec;
+    this->not_full_.exec_  = exec;
+  }
+
+  explicit AsyncRingQueue(const size_t capacity, Exec exec = {}, const StorageOptions opts = {})
+  requires Base::is_dynamic_ : Base(capacity, opts) {
+    this->not_empty_.exec_ = exec;
+    this->not_full_.exec_  = exec;
+  }
+
+ ~AsyncRingQueue() = default;
+};
+
+} //namespace rb
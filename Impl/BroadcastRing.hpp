@@ -0,0 +1,210 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingBase.hpp"
+#include "Wait.hpp"
+#include <atomic>
+#include <concepts>
+#include <optional>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+namespace rb {
+
+/// Single producer, multiple consumers, where every element is seen
+/// by every reader: the producer writes each element once and each
+/// registered reader moves its own cursor over it. The producer only
+/// reuses a slot once the slowest cursor (the gating sequence) is
+/// past it. Like the opposite index in RingQueue, that minimum is
+/// cached and only recomputed when the cached value says we're full.
+/// With no readers registered the producer never waits.
+
+template<typename T, size_t size_, size_t readers_,
+  typename Wait = BlockingWait, typename Layout = DefaultLayout>
+class BroadcastRing : protected RingBase<T, size_, Layout> {
+public:
+  using Base = RingBase<T, size_, Layout>;
+  using Base::head_;
+  using Base::tail_;
+  using Base::capacity;
+
+  using ValueType     = T;
+  using ReferenceType = T&;
+  using PointerType   = T*;
+  using WaitType      = Wait;
+
+  static_assert(readers_ > 0, "need room for at least one reader!");
+
+  /// Producer side.
+
+  template<typename ...Args> auto try_write(Args&&... args) -> bool {
+    static_assert(std::constructible_from<T, Args...>);
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    if(!has_room(lhead))
+      return false;
+
+    publish(lhead, std::forward<Args>(args)...);
+    return true;
+  }
+
+  template<typename ...Args> auto write(Args&&... args) -> void {
+    static_assert(std::constructible_from<T, Args...>);
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    not_full_.wait([&]{ return has_room(lhead); });
+    publish(lhead, std::forward<Args>(args)...);
+  }
+
+  /// Reader registration. A new reader starts at the current head,
+  /// so it only sees what's written after it joined. Returns the
+  /// reader's id, or nothing if all readers_ cursors are taken.
+
+  NODISCARD_ auto add_reader() -> std::optional<size_t> {
+    for(size_t id = 0; id < readers_; id++) {
+      bool expected = false;
+      auto& cursor  = cursors_[id];
+      if(!cursor.claimed_.compare_exchange_strong(expected, true, std::memory_order::acquire))
+        continue;
+
+      /// Publish the cursor before taking the final position: either
+      /// the producer sees us when it recomputes its gate, or we see
+      /// every element it wrote without us.
+      cursor.pos_.store(head_.load(std::memory_order::acquire), std::memory_order::relaxed);
+      cursor.active_.store(true, std::memory_order::seq_cst);
+      const size_t lhead = head_.load(std::memory_order::seq_cst);
+      cursor.pos_.store(lhead, std::memory_order::release);
+      cursor.head_cache_ = lhead;
+      return id;
+    }
+
+    return std::nullopt;
+  }
+
+  auto remove_reader(const size_t id) -> void {
+    assert(id < readers_);
+    cursors_[id].active_.store(false, std::memory_order::release);
+    cursors_[id].claimed_.store(false, std::memory_order::release);
+    not_full_.notify();
+  }
+
+  /// Reader side. Each reader may only be used by one thread.
+
+  auto try_read(const size_t id) -> std::optional<ValueType> {
+    auto& cursor = cursors_[id];
+    const size_t lpos = cursor.pos_.load(std::memory_order::relaxed);
+    if(available(cursor, lpos, 1) == 0)
+      return std::nullopt;
+
+    ValueType val = this->slot(lpos);
+    advance(cursor, lpos, 1);
+    return val;
+  }
+
+  auto read(const size_t id) -> ValueType {
+    auto& cursor = cursors_[id];
+    const size_t lpos = cursor.pos_.load(std::memory_order::relaxed);
+    not_empty_.wait([&]{ return available(cursor, lpos, 1) != 0; });
+
+    ValueType val = this->slot(lpos);
+    advance(cursor, lpos, 1);
+    return val;
+  }
+
+  /// Zero-copy: every element the reader hasn't seen yet, in storage.
+  /// Hand them back with release() once done.
+  NODISCARD_ auto read_span(const size_t id) -> RingSpan<const ValueType> {
+    auto& cursor = cursors_[id];
+    const size_t lpos  = cursor.pos_.load(std::memory_order::relaxed);
+    const size_t count = available(cursor, lpos, capacity());
+    const auto spans   = this->spans_at(lpos, count);
+    return { spans.first, spans.second };
+  }
+
+  auto release(const size_t id, const size_t amnt) -> void {
+    auto& cursor = cursors_[id];
+    const size_t lpos = cursor.pos_.load(std::memory_order::relaxed);
+    assert(amnt <= available(cursor, lpos, amnt));
+    advance(cursor, lpos, amnt);
+  }
+
+  NODISCARD_ auto is_empty(const size_t id) const -> bool {
+    const size_t lpos = cursors_[id].pos_.load(std::memory_order::relaxed);
+    return head_.load(std::memory_order::acquire) == lpos;
+  }
+
+  // wake any threads parked in the wait policy, if any.
+  auto wake_all() -> void {
+    not_empty_.wake();
+    not_full_.wake();
+  }
+
+ ~BroadcastRing() = default;
+  BroadcastRing()  = default;
+
+  explicit BroadcastRing(const size_t capacity, const StorageOptions opts = {})
+  requires Base::is_dynamic_ : Base(capacity, opts) {}
+protected:
+  /// A reader's cursor, on its own Layout::align_ block since
+  /// only that reader writes it.
+  struct alignas(Layout::align_) Cursor {
+    std::atomic<size_t> pos_{ 0 };
+    std::atomic<bool> active_{ false };
+    std::atomic<bool> claimed_{ false };
+    size_t head_cache_{ 0 };  /// reader-local copy of head_
+  };
+
+  /// Producer side: recompute the gating sequence (cached in
+  /// tail_cache_) only when the cached one says we're full.
+  NODISCARD_ auto has_room(const size_t lhead) -> bool {
+    if(lhead - this->tail_cache_ < capacity())
+      return true;
+
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    size_t gate = lhead;
+    for(auto& cursor : cursors_) {
+      if(cursor.active_.load(std::memory_order::seq_cst))
+        gate = std::min(gate, cursor.pos_.load(std::memory_order::acquire));
+    }
+
+    this->tail_cache_ = gate;
+    return lhead - gate < capacity();
+  }
+
+  /// Slots are reused in place, so whatever element was there
+  /// before (capacity() positions ago) is destroyed first. tail_
+  /// tracks the oldest element still alive, for ~RingBase().
+  template<typename ...Args>
+  auto publish(const size_t lhead, Args&&... args) -> void {
+    if(lhead >= capacity()) {
+      this->destroy(lhead - capacity(), 1);
+      tail_.store(lhead - capacity() + 1, std::memory_order::relaxed);
+    }
+
+    this->construct(lhead, std::forward<Args>(args)...);
+    head_.store(lhead + 1, std::memory_order::release);
+    not_empty_.notify();
+  }
+
+  NODISCARD_ auto available(Cursor& cursor, const size_t lpos, const size_t want) -> size_t {
+    if(cursor.head_cache_ - lpos >= want)
+      return cursor.head_cache_ - lpos;
+
+    cursor.head_cache_ = head_.load(std::memory_order::acquire);
+    return cursor.head_cache_ - lpos;
+  }
+
+  auto advance(Cursor& cursor, const size_t lpos, const size_t amnt) -> void {
+    cursor.pos_.store(lpos + amnt, std::memory_order::release);
+    not_full_.notify();
+  }
+
+  Cursor cursors_[ readers_ ]{};
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait not_empty_{};
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait not_full_{};
+};
+
+} //namespace rb
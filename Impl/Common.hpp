@@ -24,8 +24,29 @@
 #define NODISCARD_ [[nodiscard]]
 #define UNUSED_    [[maybe_unused]]
 
+#  if RB_IS_MSVC_
+#define NO_UNIQUE_ADDRESS_ [[msvc::no_unique_address]]
+#  else
+#define NO_UNIQUE_ADDRESS_ [[no_unique_address]]
+#  endif
+
 #  if RB_IS_MSVC_
 #define FORCEINLINE_ __forceinline inline
 #  else
 #define FORCEINLINE_ __attribute__((always_inline)) inline
 #  endif
+
+#  if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RB_IS_X86_ 1
+#  else
+#define RB_IS_X86_ 0
+#  endif
+
+#  if RB_IS_X86_
+#include <immintrin.h>
+#define CPU_RELAX_() _mm_pause()
+#  elif (defined(__aarch64__) || defined(__arm__)) && !RB_IS_MSVC_
+#define CPU_RELAX_() asm volatile("yield" ::: "memory")
+#  else
+#define CPU_RELAX_() ((void)0)
+#  endif
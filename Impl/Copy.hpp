@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// How the bulk operations copy trivially copyable elements into a
+/// ring. cached is a plain memcpy, which libc already vectorizes and
+/// dispatches on the CPU at runtime. streaming uses non-temporal
+/// stores, which skip the producer's cache on the way out: worth it
+/// when the consumer runs on another socket (or just far enough away
+/// that the lines would only be evicted from the producer's cache
+/// again), and for batches that are too large to stay cached anyway.
+enum class CopyMode : uint8_t {
+  cached,
+  streaming,
+};
+
+/// Below this many bytes, streaming falls back to memcpy: the fence
+/// it needs at the end costs more than a few cached lines.
+inline constexpr size_t stream_threshold = 512;
+
+namespace detail {
+#  if RB_IS_X86_
+  /// Stores align bytes at a time once dst is aligned, with unaligned
+  /// memcpy's for the head and tail. The sfence at the end orders the
+  /// (weakly ordered) streaming stores before the release store that
+  /// publishes them.
+  template<size_t align_, typename Store>
+  FORCEINLINE_ auto stream_with(std::byte* dst, const std::byte* src, size_t bytes, Store&& store) -> void {
+    const size_t head = (align_ - (reinterpret_cast<uintptr_t>(dst) & (align_ - 1))) & (align_ - 1);
+    std::memcpy(dst, src, head);
+    dst += head, src += head, bytes -= head;
+
+    for(; bytes >= align_; dst += align_, src += align_, bytes -= align_)
+      store(dst, src);
+
+    std::memcpy(dst, src, bytes);
+    _mm_sfence();
+  }
+
+  inline auto stream_sse2(std::byte* dst, const std::byte* src, const size_t bytes) -> void {
+    stream_with<16>(dst, src, bytes, [](std::byte* out, const std::byte* in) {
+      const __m128i line = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(out), line);
+    });
+  }
+
+#  if !RB_IS_MSVC_
+  __attribute__((target("avx2")))
+  inline auto stream_avx2(std::byte* dst, const std::byte* src, const size_t bytes) -> void {
+    stream_with<32>(dst, src, bytes, [](std::byte* out, const std::byte* in) __attribute__((target("avx2"))) {
+      const __m256i line = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(out), line);
+    });
+  }
+
+  NODISCARD_ inline auto has_avx2() -> bool {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+  }
+#  endif
+#  endif
+} //namespace detail
+
+/// Copies bytes from src to (non-overlapping) dst the way mode says.
+inline auto copy_bytes(void* dst, const void* src, const size_t bytes, const CopyMode mode = CopyMode::cached) -> void {
+  if(bytes == 0)
+    return;
+
+#  if RB_IS_X86_
+  if(mode == CopyMode::streaming && bytes >= stream_threshold) {
+    auto* out      = static_cast<std::byte*>(dst);
+    const auto* in = static_cast<const std::byte*>(src);
+#  if defined(__AVX2__) && !RB_IS_MSVC_
+    detail::stream_avx2(out, in, bytes);
+#  elif !RB_IS_MSVC_
+    detail::has_avx2() ? detail::stream_avx2(out, in, bytes) : detail::stream_sse2(out, in, bytes);
+#  else
+    detail::stream_sse2(out, in, bytes);
+#  endif
+    return;
+  }
+#  else
+  (void)mode;
+#  endif
+  std::memcpy(dst, src, bytes);
+}
+
+} //namespace rb
@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "Stats.hpp"
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#  if RB_IS_MSVC_
+#include <intrin.h>
+#  endif
+namespace rb {
+
+/// A cheap timestamp: the TSC on x86, the virtual counter on ARM,
+/// steady_clock nanoseconds anywhere else. Only differences between
+/// two readings mean anything, see ticks_per_second(). Readings from
+/// different cores are comparable as long as the counter is invariant
+/// and synchronized, which it is on anything recent.
+FORCEINLINE_ auto ticks() -> uint64_t {
+#  if RB_IS_X86_
+  return __rdtsc();
+#  elif defined(__aarch64__) && !RB_IS_MSVC_
+  uint64_t val;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(val));
+  return val;
+#  else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#  endif
+}
+
+/// The rate ticks() runs at. On x86 this is measured against
+/// steady_clock once, which takes a few milliseconds on first use.
+inline auto ticks_per_second() -> double {
+#  if RB_IS_X86_
+  static const double rate = []{
+    using Clock = std::chrono::steady_clock;
+    const auto start_time  = Clock::now();
+    const uint64_t start   = ticks();
+    while(Clock::now() - start_time < std::chrono::milliseconds{ 10 })
+      CPU_RELAX_();
+
+    const uint64_t end   = ticks();
+    const auto elapsed   = std::chrono::duration<double>(Clock::now() - start_time);
+    return static_cast<double>(end - start) / elapsed.count();
+  }();
+  return rate;
+#  elif defined(__aarch64__) && !RB_IS_MSVC_
+  uint64_t freq;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+  return static_cast<double>(freq);
+#  else
+  return 1e9;
+#  endif
+}
+
+/// Buckets values HDR histogram style: exact below 2 * sub_buckets_,
+/// then sub_buckets_ linear buckets per power of two, so any value is
+/// off by at most 1/sub_buckets_ (about 6%) and all of uint64_t fits
+/// in under a thousand counters.
+struct LatencyBuckets {
+  constexpr static size_t sub_bits_    = 4;
+  constexpr static size_t sub_buckets_ = size_t{ 1 } << sub_bits_;
+  constexpr static size_t count_       = (64 - sub_bits_) * sub_buckets_ + sub_buckets_;
+
+  NODISCARD_ constexpr static auto index(const uint64_t val) -> size_t {
+    if(val < 2 * sub_buckets_)
+      return static_cast<size_t>(val);
+
+    const auto shift = static_cast<size_t>(std::bit_width(val)) - sub_bits_ - 1;
+    return shift * sub_buckets_ + static_cast<size_t>(val >> shift);
+  }
+
+  /// The highest value that lands in bucket idx.
+  NODISCARD_ constexpr static auto highest(const size_t idx) -> uint64_t {
+    if(idx < 2 * sub_buckets_)
+      return idx;
+
+    const size_t shift = idx / sub_buckets_ - 1;
+    const uint64_t low = static_cast<uint64_t>(idx % sub_buckets_ + sub_buckets_) << shift;
+    return low + ((uint64_t{ 1 } << shift) - 1);
+  }
+};
+
+/// A copy of a LatencyHistogram, in ticks.
+struct LatencySnapshot {
+  std::array<uint64_t, LatencyBuckets::count_> counts{};
+  uint64_t total{ 0 };
+  uint64_t sum{ 0 };
+  uint64_t max{ 0 };
+
+  /// The value at or below which fraction q (0 to 1) of the samples
+  /// fall, rounded up to the end of its bucket.
+  NODISCARD_ auto percentile(const double q) const -> uint64_t {
+    if(total == 0)
+      return 0;
+
+    const auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < counts.size(); i++) {
+      seen += counts[i];
+      if(seen >= rank)
+        return std::min(LatencyBuckets::highest(i), max);
+    }
+    return max;
+  }
+
+  NODISCARD_ auto mean() const -> double {
+    return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total);
+  }
+
+  NODISCARD_ static auto to_nanos(const uint64_t ticks) -> std::chrono::nanoseconds {
+    return std::chrono::nanoseconds{
+      static_cast<int64_t>(static_cast<double>(ticks) * 1e9 / ticks_per_second()) };
+  }
+};
+
+/// Recorded into by one thread, read by any: every counter has a
+/// single writer, like the ones in Stats.hpp, so recording is a few
+/// relaxed stores and snapshot() never blocks it. A snapshot taken
+/// while samples are recorded may be off by those samples.
+class LatencyHistogram {
+public:
+  auto record(const uint64_t val) -> void {
+    bump(counts_[LatencyBuckets::index(val)]);
+    sum_.store(sum_.load(std::memory_order::relaxed) + val, std::memory_order::relaxed);
+    if(val > max_.load(std::memory_order::relaxed))
+      max_.store(val, std::memory_order::relaxed);
+  }
+
+  NODISCARD_ auto snapshot() const -> LatencySnapshot {
+    LatencySnapshot snap;
+    for(size_t i = 0; i < counts_.size(); i++) {
+      snap.counts[i] = counts_[i].load(std::memory_order::relaxed);
+      snap.total    += snap.counts[i];
+    }
+
+    snap.sum = sum_.load(std::memory_order::relaxed);
+    snap.max = max_.load(std::memory_order::relaxed);
+    return snap;
+  }
+
+protected:
+  std::array<std::atomic<size_t>, LatencyBuckets::count_> counts_{};
+  std::atomic<uint64_t> sum_{ 0 };
+  std::atomic<uint64_t> max_{ 0 };
+};
+
+} //namespace rb
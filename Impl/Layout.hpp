@@ -0,0 +1,60 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include <new>
+#include <cstddef>
+namespace rb {
+
+/// The distance two pieces of state need to be apart to not falsely
+/// share a cache line. Define RB_DESTRUCTIVE_SIZE to override it, e.g.
+/// to 128 where the spatial prefetcher pulls in lines in pairs.
+/// std::hardware_destructive_interference_size is fine to use here:
+/// GCC warns about it because the value may change with -mtune, but
+/// rings aren't meant to be passed across that kind of ABI boundary.
+
+#  if defined(RB_DESTRUCTIVE_SIZE)
+inline constexpr size_t destructive_size = RB_DESTRUCTIVE_SIZE;
+#  elif defined(__cpp_lib_hardware_interference_size)
+#  if RB_IS_GCC_
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#  endif
+inline constexpr size_t destructive_size = std::hardware_destructive_interference_size;
+#  if RB_IS_GCC_
+#pragma GCC diagnostic pop
+#  endif
+#  else
+inline constexpr size_t destructive_size = 64;
+#  endif
+
+/// Layout policies decide how far apart a ring keeps the state owned
+/// by each side. Each block (e.g. head_ with the producer's cached
+/// tail) starts on an align_ boundary and is padded out to one, so
+/// neither the other side's block nor whatever follows the ring in
+/// memory can end up on the same line.
+
+template<size_t bytes_>
+struct PaddedLayout {
+  static_assert((bytes_ & (bytes_ - 1)) == 0, "alignment must be a power of 2!");
+  constexpr static size_t align_ = bytes_;
+};
+
+/// One destructive_size line per block. This is the default.
+using CacheLineLayout = PaddedLayout<destructive_size>;
+
+/// Two lines per block, for CPUs whose adjacent-line prefetcher
+/// works on 128-byte pairs (most Intel cores since Sandy Bridge).
+using LinePairLayout  = PaddedLayout<2 * destructive_size>;
+
+/// A 4KB page per block, which is what NUMA placement works with:
+/// it lets each side's block live on its own node (see Numa.hpp).
+using PageLayout      = PaddedLayout<4096>;
+
+using DefaultLayout   = CacheLineLayout;
+
+} //namespace rb
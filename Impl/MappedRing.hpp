@@ -0,0 +1,201 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "SharedRing.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <expected>
+#include <mutex>
+#include <new>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// How MappedRing::open() maps an existing file. shared picks up
+/// where the last writer left off, writes go to the file. snapshot
+/// maps it copy-on-write: reading (and consuming) from the ring only
+/// changes the private copy, so an offline tool can dump a file as
+/// often as it likes without altering it.
+enum class MapMode : uint8_t { shared, snapshot };
+
+/// A ring placed in a memory mapped file, laid out exactly like a
+/// SharedRing: a SharedHeader, then the ring with its indices and
+/// slots. Since every write lands in the page cache, whatever was
+/// published survives the process dying at any point, e.g. for
+///   MappedRing<RingBuffer<Event, 1024>>::create("/var/log/app.ring")
+/// used as a flight recorder through overwrite(), and read back with
+/// open(path, MapMode::snapshot) after a crash. Surviving a kernel
+/// crash or power loss as well takes sync() or sync_every().
+/// Elements still pending under RingBase::publish_every() aren't
+/// published yet, so keep that at 1 (or flush()) for a recorder.
+
+template<typename Ring>
+class MappedRing {
+public:
+  using RingType  = Ring;
+  using ValueType = typename Ring::ValueType;
+
+  static_assert(is_process_shared<Ring>(),
+    "the ring must have a fixed size, trivially copyable elements "
+    "and a process-shared wait policy (if any)!");
+
+  constexpr static size_t ring_offset_ =
+    (sizeof(SharedHeader) + alignof(Ring) - 1) & ~(alignof(Ring) - 1);
+  constexpr static size_t map_size_ = ring_offset_ + sizeof(Ring);
+
+  /// Creates (or truncates) the file at path and constructs
+  /// an empty ring in it.
+  NODISCARD_ static auto create(const std::string& path) -> std::expected<MappedRing, std::error_code> {
+    const int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+    if(fd < 0)
+      return std::unexpected(last_error());
+
+    if(::ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+      const auto err = last_error();
+      ::close(fd);
+      return std::unexpected(err);
+    }
+
+    auto mapped = map(fd, MapMode::shared);
+    if(!mapped)
+      return std::unexpected(mapped.error());
+
+    MappedRing file{ *mapped };
+    auto* header = ::new(file.base_) SharedHeader{
+      SharedHeader::magic_,
+      SharedHeader::version_,
+      sizeof(ValueType),
+      Ring::capacity(),
+      sizeof(Ring),
+      ring_offset_,
+      { 0 }
+    };
+
+    file.ring_ = ::new(static_cast<std::byte*>(file.base_) + ring_offset_) Ring();
+    header->ready.store(1, std::memory_order::release);
+    return file;
+  }
+
+  /// Maps a file made by create(). Fails with invalid_argument if
+  /// it's too short, was never fully set up, or holds another type
+  /// of ring.
+  NODISCARD_ static auto open(const std::string& path, const MapMode mode = MapMode::shared)
+  -> std::expected<MappedRing, std::error_code> {
+    const int flags = mode == MapMode::shared ? O_RDWR : O_RDONLY;
+    const int fd    = ::open(path.c_str(), flags | O_CLOEXEC);
+    if(fd < 0)
+      return std::unexpected(last_error());
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < map_size_) {
+      ::close(fd);
+      return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    auto mapped = map(fd, mode);
+    if(!mapped)
+      return std::unexpected(mapped.error());
+
+    MappedRing file{ *mapped };
+    const SharedHeader& hdr = file.header();
+    if(hdr.ready.load(std::memory_order::acquire) == 0 || !hdr.describes<Ring>(ring_offset_))
+      return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+    file.ring_ = std::launder(reinterpret_cast<Ring*>(
+      static_cast<std::byte*>(file.base_) + ring_offset_));
+    return file;
+  }
+
+  /// Schedules writeback of the mapping. With wait, returns once it's
+  /// on disk. Does nothing useful for a snapshot.
+  auto sync(const bool wait = false) -> std::error_code {
+    if(::msync(base_, map_size_, wait ? MS_SYNC : MS_ASYNC) != 0)
+      return last_error();
+    return {};
+  }
+
+  /// Calls sync() every interval from a background thread, until
+  /// this is destroyed or sync_every() is called again. A zero
+  /// interval just stops it.
+  template<typename Rep, typename Period>
+  auto sync_every(const std::chrono::duration<Rep, Period>& interval) -> void {
+    syncer_ = std::jthread{};
+    if(interval <= interval.zero())
+      return;
+
+    syncer_ = std::jthread{ [base = base_, interval](const std::stop_token token) {
+      std::mutex lock;
+      std::condition_variable_any timer;
+      std::unique_lock guard{ lock };
+      while(!timer.wait_for(guard, token, interval, []{ return false; }) && !token.stop_requested())
+        ::msync(base, map_size_, MS_ASYNC);
+    }};
+  }
+
+  NODISCARD_ auto operator->() const -> Ring* { return ring_; }
+  NODISCARD_ auto operator*()  const -> Ring& { return *ring_; }
+
+  NODISCARD_ auto header() const -> const SharedHeader& {
+    return *std::launder(static_cast<const SharedHeader*>(base_));
+  }
+
+  MappedRing(MappedRing&& other) noexcept
+    : base_{ std::exchange(other.base_, nullptr) },
+      ring_{ std::exchange(other.ring_, nullptr) },
+      syncer_{ std::move(other.syncer_) } {}
+
+  MappedRing& operator=(MappedRing&& other) noexcept {
+    if(this != &other) {
+      unmap();
+      base_   = std::exchange(other.base_, nullptr);
+      ring_   = std::exchange(other.ring_, nullptr);
+      syncer_ = std::move(other.syncer_);
+    }
+    return *this;
+  }
+
+ ~MappedRing() { unmap(); }
+protected:
+  explicit MappedRing(void* base) : base_{ base } {}
+
+  static auto last_error() -> std::error_code {
+    return { errno, std::system_category() };
+  }
+
+  /// Maps the whole file and closes fd either way.
+  static auto map(const int fd, const MapMode mode) -> std::expected<void*, std::error_code> {
+    const int share = mode == MapMode::shared ? MAP_SHARED : MAP_PRIVATE;
+    void* base = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, share, fd, 0);
+    const auto err = last_error();
+    ::close(fd);
+
+    if(base == MAP_FAILED)
+      return std::unexpected(err);
+    return base;
+  }
+
+  /// The syncer has to be gone before the mapping is.
+  auto unmap() -> void {
+    syncer_ = std::jthread{};
+    if(base_ != nullptr)
+      ::munmap(base_, map_size_);
+  }
+
+  void* base_{ nullptr };
+  Ring* ring_{ nullptr };
+  std::jthread syncer_{};
+};
+
+} //namespace rb
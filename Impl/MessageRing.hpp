@@ -0,0 +1,133 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingBase.hpp"
+#include <optional>
+#include <span>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+namespace rb {
+
+/// A ring of variable-length messages, stored as records of a length
+/// header followed by the payload, padded to record_align_ bytes.
+/// head_ and tail_ count bytes, with the same protocol as every other
+/// ring here. A record is never split at the wrap point: if it doesn't
+/// fit in what's left before the end of the storage, the producer
+/// writes a skip marker there and starts the record at the beginning,
+/// so try_read() can always return a single contiguous view.
+/// One producer, one consumer. Both indices are stored directly, so
+/// RingBase's batch_ stays at its default of 1 and publish_every()
+/// doesn't exist here.
+
+template<size_t size_, typename Layout = DefaultLayout>
+class MessageRing : protected RingBase<std::byte, size_, Layout> {
+public:
+  using Base = RingBase<std::byte, size_, Layout>;
+  using Base::head_;
+  using Base::tail_;
+  using Base::capacity;
+  using Base::is_empty;
+
+  using ValueType = std::span<const std::byte>;
+
+  constexpr static size_t record_align_ = 8;
+  constexpr static size_t header_size_  = record_align_;
+  constexpr static uint32_t skip_marker_ = UINT32_MAX;
+
+  static_assert(Base::is_dynamic_ || size_ >= 2 * record_align_, "Size must be at least 16 bytes!");
+
+  /// The largest payload that can always be written once the ring
+  /// drains: a record plus the skip marker in front of it has to
+  /// fit in capacity(), wherever the head happens to be.
+  NODISCARD_ auto max_message() const -> size_t {
+    return capacity() / 2 - header_size_;
+  }
+
+  /// Writes msg as one record, or returns false if there's no room
+  /// for it right now (or it's bigger than max_message()).
+  auto try_write(std::span<const std::byte> msg) -> bool {
+    if(msg.size() > max_message())
+      return false;
+
+    size_t lhead        = head_.load(std::memory_order::relaxed);
+    const size_t need   = record_size(msg.size());
+    const size_t contig = capacity() - (lhead & this->size_mask_);
+    const size_t total  = need > contig ? contig + need : need;
+
+    if(this->producer_room(lhead, total) < total)
+      return false;
+
+    if(need > contig) {
+      put_header(lhead, skip_marker_);
+      lhead += contig;
+    }
+
+    put_header(lhead, static_cast<uint32_t>(msg.size()));
+    std::memcpy(&this->slot(lhead + header_size_), msg.data(), msg.size());
+    head_.store(lhead + need, std::memory_order::release);
+    return true;
+  }
+
+  /// A view of the oldest message, which stays valid (and in the
+  /// ring) until release() is called. Calling it again before
+  /// that returns the same message.
+  NODISCARD_ auto try_read() -> std::optional<ValueType> {
+    size_t ltail = tail_.load(std::memory_order::relaxed);
+    if(!this->can_consume(ltail))
+      return std::nullopt;
+
+    uint32_t len = get_header(ltail);
+    if(len == skip_marker_) {
+      ltail += capacity() - (ltail & this->size_mask_);
+      tail_.store(ltail, std::memory_order::release);
+      if(!this->can_consume(ltail))
+        return std::nullopt;
+      len = get_header(ltail);
+    }
+
+    pending_ = record_size(len);
+    return ValueType{ &this->slot(ltail + header_size_), len };
+  }
+
+  /// Drops the message last returned by try_read().
+  auto release() -> void {
+    assert(pending_ != 0);
+    tail_.store(tail_.load(std::memory_order::relaxed) + pending_, std::memory_order::release);
+    pending_ = 0;
+  }
+
+ ~MessageRing() = default;
+  MessageRing()  = default;
+
+  explicit MessageRing(const size_t capacity, const StorageOptions opts = {})
+  requires Base::is_dynamic_ : Base(capacity, opts) {
+    assert(this->capacity() >= 2 * record_align_);
+  }
+protected:
+  NODISCARD_ constexpr static auto record_size(const size_t len) -> size_t {
+    return (header_size_ + len + record_align_ - 1) & ~(record_align_ - 1);
+  }
+
+  /// Records start on record_align_ boundaries and capacity() is a
+  /// multiple of it, so a header is never split either.
+  auto put_header(const size_t pos, const uint32_t len) -> void {
+    std::memcpy(&this->slot(pos), &len, sizeof(len));
+  }
+
+  NODISCARD_ auto get_header(const size_t pos) -> uint32_t {
+    uint32_t len;
+    std::memcpy(&len, &this->slot(pos), sizeof(len));
+    return len;
+  }
+
+  size_t pending_{ 0 };  /// consumer-local
+};
+
+} //namespace rb
@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingBase.hpp"
+#include <span>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cassert>
+
+#  if !defined(__linux__)
+#error "MirrorRing.hpp needs memfd_create()."
+#  endif
+namespace rb {
+
+/// A byte stream ring whose storage is mapped twice back to back
+/// (see StorageOptions::mirrored), so reads and writes never have
+/// to be split at the wrap point: every span handed out here is a
+/// single contiguous range, ready for one memcpy, send() or a
+/// parser that expects flat memory. One producer, one consumer.
+/// The capacity is rounded up to a whole number of pages.
+/// commit() and release() publish right away, so RingBase's batch_
+/// stays at its default of 1 and there's no publish_every().
+
+template<typename Layout = DefaultLayout>
+class MirrorRing : public RingBase<std::byte, dynamic_extent, Layout> {
+public:
+  using Base = RingBase<std::byte, dynamic_extent, Layout>;
+  using Base::head_;
+  using Base::tail_;
+  using Base::capacity;
+
+  using ValueType     = std::byte;
+  using ReferenceType = std::byte&;
+  using PointerType   = std::byte*;
+
+  /// Producer side. reserve() returns up to amnt writable bytes at
+  /// the head, which are published by commit().
+
+  NODISCARD_ auto reserve(const size_t amnt) -> std::span<std::byte> {
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    const size_t count = std::min(amnt, this->producer_room(lhead, amnt));
+    return { at(lhead), count };
+  }
+
+  auto commit(const size_t amnt) -> void {
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    assert(amnt <= this->producer_room(lhead, amnt));
+    head_.store(lhead + amnt, std::memory_order::release);
+  }
+
+  /// Writes all of src, or nothing if there isn't room for it.
+  auto try_write(std::span<const std::byte> src) -> bool {
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    if(this->producer_room(lhead, src.size()) < src.size())
+      return false;
+
+    std::memcpy(at(lhead), src.data(), src.size());
+    head_.store(lhead + src.size(), std::memory_order::release);
+    return true;
+  }
+
+  /// Consumer side. read_span() returns every readable byte at
+  /// the tail, which are handed back by release().
+
+  NODISCARD_ auto read_span() -> std::span<const std::byte> {
+    const size_t ltail = tail_.load(std::memory_order::relaxed);
+    return { at(ltail), this->consumer_avail(ltail, capacity()) };
+  }
+
+  auto release(const size_t amnt) -> void {
+    const size_t ltail = tail_.load(std::memory_order::relaxed);
+    assert(amnt <= this->consumer_avail(ltail, amnt));
+    tail_.store(ltail + amnt, std::memory_order::release);
+  }
+
+  /// Reads up to dst.size() bytes, returning how many were read.
+  auto try_read(std::span<std::byte> dst) -> size_t {
+    const size_t ltail = tail_.load(std::memory_order::relaxed);
+    const size_t count = std::min(dst.size(), this->consumer_avail(ltail, dst.size()));
+
+    std::memcpy(dst.data(), at(ltail), count);
+    tail_.store(ltail + count, std::memory_order::release);
+    return count;
+  }
+
+  explicit MirrorRing(const size_t capacity)
+    : Base(capacity, StorageOptions{ .mirrored = true }) {}
+
+ ~MirrorRing() = default;
+protected:
+  /// Anything up to capacity() bytes from here is mapped.
+  NODISCARD_ FORCEINLINE_ auto at(const size_t pos) -> std::byte* {
+    return this->slots() + (pos & this->size_mask_);
+  }
+};
+
+} //namespace rb
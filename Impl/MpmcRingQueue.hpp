@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingBase.hpp"
+#include "Wait.hpp"
+#include <concepts>
+#include <utility>
+#include <optional>
+#include <cstddef>
+namespace rb {
+
+/// Multi-producer/multi-consumer sibling of RingQueue. Producers and
+/// consumers claim positions with a CAS on head_/tail_, and each slot
+/// carries a sequence number (Vyukov's bounded queue) that says
+/// whether it's ready to be written or read at a given position.
+/// is_full() and is_empty() are only snapshots here, since with
+/// several threads on each side they may be stale immediately.
+/// Every claim is published right away, so RingBase's batch_ stays at
+/// its default of 1 and there's no publish_every().
+
+template<typename T, size_t size_, typename Wait = BlockingWait, typename Layout = DefaultLayout>
+class MpmcRingQueue : public RingBase<T, size_, Layout> {
+public:
+  using RingBase<T, size_, Layout>::head_;
+  using RingBase<T, size_, Layout>::tail_;
+  using RingBase<T, size_, Layout>::size_mask_;
+
+  using ValueType     = T;
+  using ReferenceType = T&;
+  using PointerType   = T*;
+  using WaitType      = Wait;
+
+  static_assert(size_ != dynamic_extent, "MpmcRingQueue needs a fixed size!");
+
+  template<typename ...Args> auto try_enqueue(Args&&... args) -> bool {
+    static_assert(std::constructible_from<T, Args...>);
+    size_t lhead = head_.load(std::memory_order::relaxed);
+
+    for(;;) {
+      const size_t seq = seq_[ lhead & size_mask_ ].load(std::memory_order::acquire);
+      const auto diff  = static_cast<std::ptrdiff_t>(seq - lhead);
+
+      if(diff == 0) {
+        if(head_.compare_exchange_weak(lhead, lhead + 1, std::memory_order::relaxed))
+          break;
+      } else if(diff < 0) {
+        return false; /// the slot hasn't been read yet, we're full.
+      } else {
+        lhead = head_.load(std::memory_order::relaxed);
+      }
+    }
+
+    this->construct(lhead, std::forward<Args>(args)...);
+    seq_[ lhead & size_mask_ ].store(lhead + 1, std::memory_order::release);
+    not_empty_.notify();
+    return true;
+  }
+
+  auto try_dequeue() -> std::optional<ValueType> {
+    size_t ltail = tail_.load(std::memory_order::relaxed);
+
+    for(;;) {
+      const size_t seq = seq_[ ltail & size_mask_ ].load(std::memory_order::acquire);
+      const auto diff  = static_cast<std::ptrdiff_t>(seq - (ltail + 1));
+
+      if(diff == 0) {
+        if(tail_.compare_exchange_weak(ltail, ltail + 1, std::memory_order::relaxed))
+          break;
+      } else if(diff < 0) {
+        return std::nullopt; /// the slot hasn't been written yet, we're empty.
+      } else {
+        ltail = tail_.load(std::memory_order::relaxed);
+      }
+    }
+
+    ValueType val = this->take(ltail);
+    seq_[ ltail & size_mask_ ].store(ltail + size_, std::memory_order::release);
+    not_full_.notify();
+    return val;
+  }
+
+  /// Blocking variants. args are only consumed by the
+  /// try_enqueue() call that succeeds, so retrying with
+  /// them is fine. The wait policy may check the condition
+  /// again after it held, so once an attempt succeeds the
+  /// predicate only reports it.
+
+  template<typename ...Args> auto enqueue(Args&&... args) -> void {
+    bool done = false;
+    not_full_.wait([&]{ return done || (done = try_enqueue(std::forward<Args>(args)...)); });
+  }
+
+  auto dequeue() -> ValueType {
+    std::optional<ValueType> val;
+    not_empty_.wait([&]{ return val.has_value() || (val = try_dequeue()).has_value(); });
+    return std::move(*val);
+  }
+
+  // wake any threads parked in the wait policy, if any.
+  auto wake_all() -> void {
+    not_empty_.wake();
+    not_full_.wake();
+  }
+
+ ~MpmcRingQueue() = default;
+  MpmcRingQueue() {
+    for(size_t i = 0; i < size_; i++)
+      seq_[i].store(i, std::memory_order::relaxed);
+  }
+
+protected:
+  alignas(Layout::align_) std::atomic<size_t> seq_[ size_ ];
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait not_empty_{};
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait not_full_{};
+};
+
+} //namespace rb
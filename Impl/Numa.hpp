@@ -0,0 +1,215 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingStorage.hpp"
+#include "Layout.hpp"
+#include <filesystem>
+#include <string>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#  if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <unistd.h>
+#  endif
+namespace rb {
+
+/// NUMA placement for rings shared by two threads pinned to known
+/// CPUs. What matters most is that the slots sit on the consumer's
+/// node (see StorageOptions::numa_node). Beyond that each side's
+/// block of indices can sit on its owner's node, which takes a ring
+/// whose blocks are on separate pages, i.e. PageLayout. Everything
+/// here is best effort: on a single node machine, or without NUMA
+/// support, it all still works and just places nothing.
+
+/// The node cpu belongs to, or -1 if that's unknown.
+inline auto node_of_cpu(UNUSED_ const unsigned cpu) -> int {
+#  if defined(__linux__)
+  namespace fs = std::filesystem;
+  std::error_code err;
+  const fs::path dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  for(const auto& entry : fs::directory_iterator{ dir, err }) {
+    const std::string name = entry.path().filename().string();
+    if(name.starts_with("node") && name.size() > 4 && name.find_first_not_of("0123456789", 4) == std::string::npos)
+      return std::stoi(name.substr(4));
+  }
+#  endif
+  return -1;
+}
+
+/// The node the calling thread is running on right now.
+inline auto current_node() -> int {
+#  if defined(__linux__)
+  unsigned cpu = 0, node = 0;
+  if(::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+    return static_cast<int>(node);
+#  endif
+  return -1;
+}
+
+/// The node the page holding addr is on. It has to have been
+/// touched already, otherwise there's no page yet.
+inline auto node_of(UNUSED_ const void* addr) -> int {
+#  if defined(__linux__)
+  int node = -1;
+  if(::syscall(SYS_get_mempolicy, &node, nullptr, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) == 0)
+    return node;
+#  endif
+  return -1;
+}
+
+/// Where a ring's producer and consumer run. -1 means unknown,
+/// and leaves that side's memory wherever it lands.
+struct Placement {
+  int producer_node{ -1 };
+  int consumer_node{ -1 };
+
+  NODISCARD_ static auto between_cpus(const unsigned producer_cpu, const unsigned consumer_cpu) -> Placement {
+    return { node_of_cpu(producer_cpu), node_of_cpu(consumer_cpu) };
+  }
+};
+
+/// A ring in its own page-aligned allocation, placed per a Placement:
+/// the ring object on the consumer's node, then the pages of the
+/// producer's block (head_ up to tail_) moved to the producer's node.
+/// That only happens when head_ and tail_ both start a page, as with
+/// PageLayout: then those pages hold nothing but the producer's block.
+/// Otherwise they may share a page with the slots or the consumer's
+/// fields, and everything stays on the consumer's node. Owns the
+/// ring, like a unique_ptr. Made by make_between().
+
+template<typename Ring>
+class PlacedRing {
+public:
+  using RingType = Ring;
+
+  template<typename ...Args>
+  NODISCARD_ static auto create(const Placement where, Args&&... args) -> PlacedRing {
+    void* mem = allocate();
+    bind_to_node(mem, bytes_, where.consumer_node);
+
+    Ring* ring = nullptr;
+    try {
+      ring = ::new(mem) Ring(std::forward<Args>(args)...);
+    } catch(...) {
+      deallocate(mem);
+      throw;
+    }
+
+    PlacedRing placed{ ring, where };
+
+    auto* head = reinterpret_cast<std::byte*>(&placed.ring_->head_);
+    auto* tail = reinterpret_cast<std::byte*>(&placed.ring_->tail_);
+    if(where.producer_node >= 0 && where.producer_node != where.consumer_node
+    && page_aligned(head) && page_aligned(tail) && head != tail)
+      bind_to_node(head, static_cast<size_t>(tail - head), where.producer_node);
+
+    return placed;
+  }
+
+  NODISCARD_ auto operator->() const -> Ring* { return ring_; }
+  NODISCARD_ auto operator*()  const -> Ring& { return *ring_; }
+
+  NODISCARD_ auto placement() const -> Placement {
+    return where_;
+  }
+
+  PlacedRing(PlacedRing&& other) noexcept
+    : ring_{ std::exchange(other.ring_, nullptr) }, where_{ other.where_ } {}
+
+  PlacedRing& operator=(PlacedRing&& other) noexcept {
+    if(this != &other) {
+      release();
+      ring_  = std::exchange(other.ring_, nullptr);
+      where_ = other.where_;
+    }
+    return *this;
+  }
+
+ ~PlacedRing() { release(); }
+protected:
+  /// The ring gets pages of its own, so binding them
+  /// can't move anything else.
+  constexpr static size_t page_size_ = 4096;
+  constexpr static size_t bytes_     = sizeof(Ring);
+
+  static_assert(alignof(Ring) <= page_size_);
+
+  PlacedRing(Ring* ring, const Placement where)
+    : ring_{ ring }, where_{ where } {}
+
+  /// Whether addr starts a page, of the system's page size: where
+  /// that's bigger than PageLayout's, nothing gets split off.
+  NODISCARD_ static auto page_aligned(const std::byte* addr) -> bool {
+#  if defined(__linux__)
+    const auto mask = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE) - 1);
+#  else
+    const auto mask = static_cast<uintptr_t>(page_size_ - 1);
+#  endif
+    return (reinterpret_cast<uintptr_t>(addr) & mask) == 0;
+  }
+
+  NODISCARD_ static auto allocate() -> void* {
+#  if defined(__linux__)
+    void* mem = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED)
+      throw std::bad_alloc{};
+    return mem;
+#  else
+    return ::operator new(bytes_, std::align_val_t{ page_size_ });
+#  endif
+  }
+
+  static auto deallocate(void* mem) -> void {
+#  if defined(__linux__)
+    ::munmap(mem, bytes_);
+#  else
+    ::operator delete(mem, std::align_val_t{ page_size_ });
+#  endif
+  }
+
+  auto release() -> void {
+    if(ring_ == nullptr)
+      return;
+
+    std::destroy_at(ring_);
+    deallocate(ring_);
+    ring_ = nullptr;
+  }
+
+  Ring* ring_{ nullptr };
+  Placement where_{};
+};
+
+/// Constructs Ring between a producer and a consumer running at
+/// where, e.g. with both threads pinned:
+///   auto queue = make_between<RingQueue<Msg, 4096, BlockingWait, PageLayout>>(
+///     Placement::between_cpus(2, 34));
+/// Rings with a runtime capacity also get their slots on the
+/// consumer's node, unless opts already says where.
+
+template<typename Ring>
+requires (!Ring::is_dynamic_)
+NODISCARD_ auto make_between(const Placement where) -> PlacedRing<Ring> {
+  return PlacedRing<Ring>::create(where);
+}
+
+template<typename Ring>
+requires Ring::is_dynamic_
+NODISCARD_ auto make_between(const Placement where, const size_t capacity, StorageOptions opts = {}) -> PlacedRing<Ring> {
+  if(opts.numa_node < 0)
+    opts.numa_node = where.consumer_node;
+  return PlacedRing<Ring>::create(where, capacity, opts);
+}
+
+} //namespace rb
@@ -0,0 +1,150 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingQueue.hpp"
+#include "Wait.hpp"
+#include <atomic>
+#include <optional>
+#include <utility>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// lanes_ RingQueues drained by one consumer in priority order, lane 0
+/// first. Each lane has its own producer, so e.g. control messages on
+/// lane 0 overtake whatever bulk data is queued up on the others.
+/// A bitmask of the lanes that may be non-empty lets the consumer find
+/// the next lane with a single load, and a single wait policy stands in
+/// for all the lanes' not_empty_ ones, so a blocked consumer is woken by
+/// a push to any lane.
+///
+/// A lane's bit is set by its producer after every push that finds it
+/// clear, and only cleared by the consumer when it finds that lane empty.
+/// Pushes only notify ready_, the lanes' own not_empty_ go unused: the
+/// consumer side of a lane mustn't be blocked on directly.
+
+template<typename T, size_t size_, size_t lanes_,
+  typename Wait = BlockingWait, typename Layout = DefaultLayout>
+class PriorityRingQueue {
+public:
+  using ValueType = T;
+
+  /// A RingQueue whose pushes through us skip its not_empty_.
+  class LaneType : public RingQueue<T, size_, Wait, Layout> {
+    friend PriorityRingQueue;
+  };
+
+  static_assert(lanes_ > 0 && lanes_ <= 64, "need between 1 and 64 lanes!");
+
+  NODISCARD_ constexpr static auto lane_count() -> size_t {
+    return lanes_;
+  }
+
+  /// Producer side. Each lane may only be pushed to by one thread.
+
+  template<typename ...Args>
+  auto try_enqueue(const size_t lane, Args&&... args) -> bool {
+    assert(lane < lanes_);
+    if(!lanes_arr_[lane].try_enqueue_quiet(std::forward<Args>(args)...))
+      return false;
+
+    mark(lane);
+    return true;
+  }
+
+  template<typename ...Args>
+  auto enqueue(const size_t lane, Args&&... args) -> void {
+    assert(lane < lanes_);
+    lanes_arr_[lane].enqueue_quiet(std::forward<Args>(args)...);
+    mark(lane);
+  }
+
+  /// Consumer side, one thread only.
+
+  /// Takes the oldest element of the highest priority lane that
+  /// has any.
+  auto try_dequeue() -> std::optional<ValueType> {
+    uint64_t mask = ready_mask_.load(std::memory_order::acquire);
+    while(mask != 0) {
+      const auto lane = static_cast<size_t>(std::countr_zero(mask));
+      if(auto val = lanes_arr_[lane].try_dequeue())
+        return val;
+
+      /// The lane ran empty: clear its bit, then look again, in
+      /// case its producer saw the bit still set and didn't mark.
+      ready_mask_.fetch_and(~bit(lane), std::memory_order::acq_rel);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if(!lanes_arr_[lane].is_empty()) {
+        ready_mask_.fetch_or(bit(lane), std::memory_order::relaxed);
+        continue;
+      }
+
+      mask &= ~bit(lane);
+    }
+
+    return std::nullopt;
+  }
+
+  /// The wait policy may check the condition again after it
+  /// held, hence val first.
+  auto dequeue() -> ValueType {
+    std::optional<ValueType> val;
+    ready_.wait([&]{
+      if(!val.has_value())
+        val = try_dequeue();
+      return val.has_value();
+    });
+
+    return std::move(*val);
+  }
+
+  NODISCARD_ auto is_empty() const -> bool {
+    for(const auto& lane : lanes_arr_) {
+      if(!lane.is_empty())
+        return false;
+    }
+    return true;
+  }
+
+  NODISCARD_ auto lane(const size_t id) -> LaneType& {
+    return lanes_arr_[id];
+  }
+
+  auto wake_all() -> void {
+    ready_.wake();
+    for(auto& lane : lanes_arr_)
+      lane.wake_all();
+  }
+
+ ~PriorityRingQueue() = default;
+  PriorityRingQueue()  = default;
+protected:
+  NODISCARD_ constexpr static auto bit(const size_t lane) -> uint64_t {
+    return uint64_t{ 1 } << lane;
+  }
+
+  /// Pairs with the fence in try_dequeue(): either we see the bit
+  /// cleared and set it again, or the consumer sees our element.
+  auto mark(const size_t lane) -> void {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if((ready_mask_.load(std::memory_order::relaxed) & bit(lane)) == 0)
+      ready_mask_.fetch_or(bit(lane), std::memory_order::release);
+    ready_.notify();
+  }
+
+  LaneType lanes_arr_[ lanes_ ]{};
+  alignas(Layout::align_) std::atomic<uint64_t> ready_mask_{ 0 };
+
+  /// Notified by every push, waited on by dequeue() across all lanes.
+  /// The only notify a push pays for.
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait ready_{};
+};
+
+} //namespace rb
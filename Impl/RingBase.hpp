@@ -6,47 +6,372 @@
 #pragma once
 
 #include "Common.hpp"
+#include "RingStorage.hpp"
+#include "Layout.hpp"
+#include "Stats.hpp"
+#include "Copy.hpp"
 #include <atomic>
+#include <algorithm>
+#include <span>
+#include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
+#include <functional>
 #include <cstdint>
 #include <cassert>
 namespace rb {
 
-template<typename T, size_t size_>
-class RingBase {
+/// Up to two contiguous views into a ring's storage,
+/// split at the wrap point. second is empty if the
+/// range doesn't wrap.
+template<typename T>
+struct RingSpan {
+  std::span<T> first;
+  std::span<T> second;
+
+  NODISCARD_ auto size()  const -> size_t { return first.size() + second.size(); }
+  NODISCARD_ auto empty() const -> bool   { return size() == 0; }
+};
+
+/// Why a timed or closable operation didn't go through.
+enum class RingStatus : uint8_t {
+  timeout,  /// the deadline passed first
+  closed,   /// close() was called (and, when reading, the ring is drained)
+};
+
+/// size_ may be dynamic_extent, in which case the capacity is
+/// passed to the constructor instead (see RingStorage.hpp).
+/// Layout is one of the policies in Layout.hpp, Stats one of
+/// those in Stats.hpp. batch_ fixes publish_every() at compile time:
+/// 1 (the default) publishes every element, and runtime_batch leaves
+/// it to be set at runtime (see RingTraits.hpp).
+
+/// batch_ for a ring whose publish_every() is set at runtime. Every
+/// operation pays for the pending counts then, so it's opt-in.
+constexpr size_t runtime_batch = 0;
+
+template<typename T, size_t size_, typename Layout = DefaultLayout,
+  typename Stats = NoStats, size_t batch_ = 1>
+class RingBase : public RingStorage<T, size_> {
 public:
-  constexpr static bool can_mod_opt_ = (size_ & (size_ - 1)) == 0;
-  constexpr static size_t size_mask_ = size_ - 1;
+  using RingStorage<T, size_>::size_mask_;
+  using RingStorage<T, size_>::capacity;
+
+  constexpr static bool is_dynamic_  = size_ == dynamic_extent;
+  constexpr static bool can_mod_opt_ = is_dynamic_ || (size_ & (size_ - 1)) == 0;
 
-  static_assert(std::is_trivially_destructible_v<T>);
   static_assert(can_mod_opt_, "size must be a power of 2!");
   static_assert(size_ > 1, "Size must be greater than 1!");
+  static_assert(is_dynamic_ || batch_ <= size_, "can't batch more than the capacity!");
+
+  /// head_ and tail_ only ever increase, so their difference is the
+  /// number of elements in the ring and every slot can be used.
 
   NODISCARD_ auto is_full()  const -> bool {
     constexpr auto order  = std::memory_order::acquire;
-    const size_t lhead    = (head_.load(order) + 1) & size_mask_;
-    const size_t ltail    = tail_.load(order) & size_mask_;
-    return lhead == ltail;
+    const size_t ltail    = tail_.load(order);
+    const size_t lhead    = head_.load(order);
+    return lhead - ltail >= capacity();
   }
 
   NODISCARD_ auto is_empty() const -> bool {
     constexpr auto order  = std::memory_order::acquire;
-    const size_t lhead    = head_.load(order) & size_mask_;
-    const size_t ltail    = tail_.load(order) & size_mask_;
+    const size_t ltail    = tail_.load(order);
+    const size_t lhead    = head_.load(order);
     return lhead == ltail;
   }
 
+  /// head_ and tail_ double as the enqueue/dequeue counts. Waits
+  /// are counted by the wait policies, see RingQueue::stats().
+  /// high_water is sampled by both sides (see note_fill()) and
+  /// against the fill right now, so a peak between samples that
+  /// neither side looked at can be missed.
+  NODISCARD_ auto stats() const -> RingStatsSnapshot
+  requires Stats::enabled_ {
+    RingStatsSnapshot snap;
+    snap.enqueued   = head_.load(std::memory_order::relaxed);
+    snap.dequeued   = tail_.load(std::memory_order::relaxed);
+    snap.full_hits  = producer_stats_.hits_.load(std::memory_order::relaxed);
+    snap.empty_hits = consumer_stats_.hits_.load(std::memory_order::relaxed);
+    snap.high_water = std::max({
+      producer_stats_.high_water_.load(std::memory_order::relaxed),
+      consumer_stats_.high_water_.load(std::memory_order::relaxed),
+      snap.enqueued - std::min(snap.enqueued, snap.dequeued),
+    });
+    return snap;
+  }
+
+  /// Lazy publication: with k > 1, RingQueue and RingBuffer only
+  /// store head_/tail_ every k elements. The consumer also publishes
+  /// whenever it runs out of elements. The producer also publishes
+  /// before it waits for room or fails for lack of it, and on flush().
+  /// That halves the traffic on the index lines on a busy ring, at
+  /// the cost of the other side seeing elements (or free slots) up to
+  /// k - 1 elements late. Set it before either side starts. Only
+  /// rings with batch_ == runtime_batch have it.
+  auto publish_every(const size_t k) -> void
+  requires (batch_ == runtime_batch) {
+    assert(k > 0);
+    head_batch_ = k;
+    tail_batch_ = k;
+  }
+
   NODISCARD_ FORCEINLINE_ auto* data(this auto&& self) {
-    return std::forward<decltype(self)>(self).buff_;
+    return std::forward<decltype(self)>(self).slots();
+  }
+
+  /// Whatever is still in the ring gets destroyed with it. This
+  /// has to happen here rather than in RingStorage, since that's
+  /// the only place head_ and tail_ are known.
+ ~RingBase() requires std::is_trivially_destructible_v<T> = default;
+ ~RingBase() {
+    const size_t ltail = tail_.load(std::memory_order::acquire) + tail_pending_;
+    const size_t lhead = head_.load(std::memory_order::acquire) + head_pending_;
+    destroy(ltail, lhead - ltail);
   }
 
- ~RingBase() = default;
   RingBase() = default;
+
+  explicit RingBase(const size_t capacity, const StorageOptions opts = {})
+  requires is_dynamic_ : RingStorage<T, size_>(capacity, opts) {}
 protected:
-  alignas(64) T buff_[ size_ ]{};
-  alignas(64) std::atomic<size_t> head_{ 0 };
-  alignas(64) std::atomic<size_t> tail_{ 0 };
+  using RingStorage<T, size_>::buff_;
+  using RingStorage<T, size_>::slots;
+
+  /// Where each side really is, pending (unpublished) elements
+  /// included. Owners only, see publish_every().
+  /// With batch_ == 1 nothing is ever pending, and all of this
+  /// compiles down to the plain loads and stores.
+  NODISCARD_ FORCEINLINE_ auto producer_pos() const -> size_t {
+    if constexpr(batch_ == 1)
+      return head_.load(std::memory_order::relaxed);
+    return head_.load(std::memory_order::relaxed) + head_pending_;
+  }
+
+  NODISCARD_ FORCEINLINE_ auto consumer_pos() const -> size_t {
+    if constexpr(batch_ == 1)
+      return tail_.load(std::memory_order::relaxed);
+    return tail_.load(std::memory_order::relaxed) + tail_pending_;
+  }
+
+  /// Move a side to pos, publishing it if a whole batch is pending
+  /// (or, for the consumer, it ran out of elements). Returns whether
+  /// it did, i.e. whether the other side needs a notify.
+  FORCEINLINE_ auto publish_head(const size_t pos) -> bool {
+    if constexpr(batch_ == 1) {
+      head_.store(pos, std::memory_order::release);
+      return true;
+    }
+
+    head_pending_ = pos - head_.load(std::memory_order::relaxed);
+    if(head_pending_ < batch_or(head_batch_))
+      return false;
+    return flush_head();
+  }
+
+  FORCEINLINE_ auto publish_tail(const size_t pos) -> bool {
+    if constexpr(batch_ == 1) {
+      tail_.store(pos, std::memory_order::release);
+      return true;
+    }
+
+    tail_pending_ = pos - tail_.load(std::memory_order::relaxed);
+    if(tail_pending_ < batch_or(tail_batch_) && pos != head_cache_)
+      return false;
+    return flush_tail();
+  }
+
+  NODISCARD_ FORCEINLINE_ constexpr static auto batch_or(const size_t runtime) -> size_t {
+    if constexpr(batch_ != runtime_batch)
+      return batch_;
+    return runtime;
+  }
+
+  /// Publish whatever the producer has pending.
+  FORCEINLINE_ auto flush_head() -> bool {
+    if constexpr(batch_ == 1)
+      return false;
+    if(head_pending_ == 0)
+      return false;
+
+    head_.store(head_.load(std::memory_order::relaxed) + head_pending_, std::memory_order::release);
+    head_pending_ = 0;
+    return true;
+  }
+
+  /// Publish whatever the consumer has pending.
+  FORCEINLINE_ auto flush_tail() -> bool {
+    if constexpr(batch_ == 1)
+      return false;
+    if(tail_pending_ == 0)
+      return false;
+
+    tail_.store(tail_.load(std::memory_order::relaxed) + tail_pending_, std::memory_order::release);
+    tail_pending_ = 0;
+    return true;
+  }
+
+  /// Producer side: number of free slots at lhead. tail_ is only loaded
+  /// (and the cached copy refreshed) when the cached value can't satisfy
+  /// `want` elements, so the consumer's line isn't pulled over on every
+  /// operation.
+  NODISCARD_ FORCEINLINE_ auto producer_room(const size_t lhead, const size_t want) -> size_t {
+    if(capacity() - (lhead - tail_cache_) >= want)
+      return capacity() - (lhead - tail_cache_);
+
+    tail_cache_ = tail_.load(std::memory_order::acquire);
+    const size_t room = capacity() - (lhead - tail_cache_);
+    if constexpr(Stats::enabled_) {
+      if(room < want)
+        bump(producer_stats_.hits_);
+      note_fill(producer_stats_, capacity() - room);
+    }
+    return room;
+  }
+
+  /// Consumer side: number of readable elements at ltail.
+  /// Same idea as producer_room(), but with the cached copy of head_.
+  NODISCARD_ FORCEINLINE_ auto consumer_avail(const size_t ltail, const size_t want) -> size_t {
+    if(ltail < head_cache_ && head_cache_ - ltail >= want)
+      return head_cache_ - ltail;
+
+    head_cache_ = head_.load(std::memory_order::acquire);
+    const size_t avail = ltail < head_cache_ ? head_cache_ - ltail : 0;
+    if constexpr(Stats::enabled_) {
+      if(avail < want)
+        bump(consumer_stats_.hits_);
+      note_fill(consumer_stats_, avail);
+    }
+    return avail;
+  }
+
+  /// Either side, whenever it reloads the other one's index: that's
+  /// when it sees the fill exactly, and it costs no extra shared load.
+  FORCEINLINE_ static auto note_fill(typename Stats::Side& side, const size_t fill) -> void {
+    if(fill > side.high_water_.load(std::memory_order::relaxed))
+      side.high_water_.store(fill, std::memory_order::relaxed);
+  }
+
+  NODISCARD_ FORCEINLINE_ auto can_produce(const size_t lhead) -> bool {
+    return producer_room(lhead, 1) != 0;
+  }
+
+  NODISCARD_ FORCEINLINE_ auto can_consume(const size_t ltail) -> bool {
+    return consumer_avail(ltail, 1) != 0;
+  }
+
+  /// The element at index pos, which must have been constructed.
+  NODISCARD_ FORCEINLINE_ auto slot(const size_t pos) -> T& {
+    return *std::launder(slots() + (pos & size_mask_));
+  }
+
+  NODISCARD_ FORCEINLINE_ auto slot(const size_t pos) const -> const T& {
+    return *std::launder(slots() + (pos & size_mask_));
+  }
+
+  /// Construct an element directly in the slot at index pos.
+  template<typename ...Args>
+  FORCEINLINE_ auto construct(const size_t pos, Args&&... args) -> void {
+    ::new(static_cast<void*>(slots() + (pos & size_mask_))) T(std::forward<Args>(args)...);
+  }
+
+  /// Move the element at index pos out of its slot and destroy it.
+  NODISCARD_ FORCEINLINE_ auto take(const size_t pos) -> T {
+    T& elem = slot(pos);
+    T val   = std::move(elem);
+    std::destroy_at(&elem);
+    return val;
+  }
+
+  /// Copy count elements into/out of the ring starting at index pos.
+  /// This is done in at most two contiguous segments around the wrap
+  /// point. Trivially copyable types go through copy_bytes() (see
+  /// Copy.hpp), which is where mode comes in. copy_in() constructs the
+  /// new elements, move_out() destroys the ones it moved from.
+  auto copy_in(const size_t pos, const T* src, const size_t count,
+    UNUSED_ const CopyMode mode = CopyMode::cached) -> void {
+    const size_t start = pos & size_mask_;
+    const size_t first = std::min(count, capacity() - start);
+    if constexpr(std::is_trivially_copyable_v<T>) {
+      copy_bytes(slots() + start, src, first * sizeof(T), mode);
+      copy_bytes(slots(), src + first, (count - first) * sizeof(T), mode);
+    } else {
+      std::uninitialized_copy_n(src, first, slots() + start);
+      std::uninitialized_copy_n(src + first, count - first, slots());
+    }
+  }
+
+  auto move_out(const size_t pos, T* dst, const size_t count) -> void {
+    const size_t start = pos & size_mask_;
+    const size_t first = std::min(count, capacity() - start);
+    if constexpr(std::is_trivially_copyable_v<T>) {
+      copy_bytes(dst, slots() + start, first * sizeof(T));
+      copy_bytes(dst + first, slots(), (count - first) * sizeof(T));
+      return;
+    }
+
+    std::move(slots() + start, slots() + start + first, dst);
+    std::move(slots(), slots() + (count - first), dst + first);
+    std::destroy_n(slots() + start, first);
+    std::destroy_n(slots(), count - first);
+  }
+
+  /// Invoke fn on count elements in place, starting at index pos,
+  /// destroying each one after. Two contiguous runs, as in copy_in().
+  template<typename F>
+  auto consume_n(const size_t pos, const size_t count, F& fn) -> void {
+    const size_t start = pos & size_mask_;
+    const size_t first = std::min(count, capacity() - start);
+    for(T* elem = slots() + start; elem != slots() + start + first; elem++) {
+      std::invoke(fn, *std::launder(elem));
+      std::destroy_at(elem);
+    }
+    for(T* elem = slots(); elem != slots() + (count - first); elem++) {
+      std::invoke(fn, *std::launder(elem));
+      std::destroy_at(elem);
+    }
+  }
+
+  /// Destroy count elements starting at index pos.
+  auto destroy(const size_t pos, const size_t count) -> void {
+    if constexpr(!std::is_trivially_destructible_v<T>) {
+      for(size_t i = pos; i < pos + count; i++)
+        std::destroy_at(&slot(i));
+    }
+  }
+
+  /// Views over count slots starting at index pos, used by the
+  /// zero-copy reserve()/commit() and read_span()/release() APIs.
+  NODISCARD_ auto spans_at(const size_t pos, const size_t count) -> RingSpan<T> {
+    const size_t start = pos & size_mask_;
+    const size_t first = std::min(count, capacity() - start);
+    return RingSpan<T>{
+      std::span<T>{ slots() + start, first },
+      std::span<T>{ slots(), count - first }
+    };
+  }
+
+  /// Memory ordering: each index has a single writer, so its owner
+  /// loads it relaxed and publishes it with a plain release store
+  /// (no locked RMW). The other side loads it with acquire, which
+  /// pairs with that store: the consumer then sees the constructed
+  /// elements, and the producer sees the slots it gets back as done
+  /// with. Nothing else needs ordering on the SPSC paths.
+  ///
+  /// Producer-owned and consumer-owned state each get their own
+  /// Layout::align_ block. Since that's also the alignment of the
+  /// whole ring, the last block is padded out as well.
+  alignas(Layout::align_) std::atomic<size_t> head_{ 0 };
+  size_t tail_cache_{ 0 };    /// producer-local copy of tail_
+  size_t head_pending_{ 0 };  /// written but not published yet
+  size_t head_batch_{ 1 };
+  NO_UNIQUE_ADDRESS_ typename Stats::Side producer_stats_{};
+  alignas(Layout::align_) std::atomic<size_t> tail_{ 0 };
+  size_t head_cache_{ 0 };    /// consumer-local copy of head_
+  size_t tail_pending_{ 0 };  /// consumed but not published yet
+  size_t tail_batch_{ 1 };
+  NO_UNIQUE_ADDRESS_ typename Stats::Side consumer_stats_{};
 };
 
 } //namespace rb
\ No newline at end of file
@@ -10,44 +10,69 @@
 #include <optional>
 #include <utility>
 #include <concepts>
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
 namespace rb {
 
-template<typename T, size_t size_>
-class RingBuffer : public RingBase<T, size_>{
+/// Layout is one of the policies in Layout.hpp, Stats one of
+/// those in Stats.hpp, batch_ is RingBase's. See RingTraits.hpp
+/// for all of them in one struct.
+
+template<typename T, size_t size_, typename Layout = DefaultLayout,
+  typename Stats = NoStats, size_t batch_ = 1>
+class RingBuffer : public RingBase<T, size_, Layout, Stats, batch_>{
 public:
   using ValueType     = T;
   using ReferenceType = T&;
   using PointerType   = T*;
 
-  using RingBase<T, size_>::head_;
-  using RingBase<T, size_>::tail_;
-  using RingBase<T, size_>::buff_;
-  using RingBase<T, size_>::can_mod_opt_;
-  using RingBase<T, size_>::size_mask_;
+  using RingBase<T, size_, Layout, Stats, batch_>::head_;
+  using RingBase<T, size_, Layout, Stats, batch_>::tail_;
+  using RingBase<T, size_, Layout, Stats, batch_>::can_mod_opt_;
+  using RingBase<T, size_, Layout, Stats, batch_>::size_mask_;
 
   /// write() and overwrite() will attempt to construct
   /// an object of type T directly at the head index using the
-  /// parameter pack Args.
+  /// parameter pack Args. overwrite() destroys the oldest
+  /// element first if the buffer is full. Since that means
+  /// touching tail_ from the producer, it's not safe to use
+  /// overwrite() while another thread reads: use SeqRingBuffer
+  /// for that. For the same reason it may publish what the
+  /// consumer has read but not published yet (see publish_every()),
+  /// since those slots are free rather than the oldest elements.
 
   template<typename ...Args>
   auto write(Args&&... args) -> bool {
     static_assert(std::constructible_from<T, Args...>);
-    if(this->is_full())
+    const size_t lhead = this->producer_pos();
+    if(!this->can_produce(lhead)) {
+      this->flush_head();
       return false;
+    }
 
-    buff_[ head_.load() & size_mask_ ] = T(std::forward<Args>(args)...);
-    head_.fetch_add(1, std::memory_order::release);
+    this->construct(lhead, std::forward<Args>(args)...);
+    this->publish_head(lhead + 1);
     return true;
   }
 
   template<typename ...Args>
   auto overwrite(Args&&... args) -> void {
     static_assert(std::constructible_from<T, Args...>);
-    if(this->is_full())
-      tail_.fetch_add(1, std::memory_order::release);
+    const size_t lhead = this->producer_pos();
+    if(!this->can_produce(lhead) && (!this->flush_tail() || !this->can_produce(lhead))) {
+      this->destroy(this->tail_cache_, 1);
+      this->tail_cache_ = tail_.fetch_add(1, std::memory_order::release) + 1;
+    }
+
+    this->construct(lhead, std::forward<Args>(args)...);
+    this->publish_head(lhead + 1);
+  }
 
-    buff_[ head_.load() & size_mask_ ] = T(std::forward<Args>(args)...);
-    head_.fetch_add(1, std::memory_order::release);
+  /// Publishes whatever the producer has pending, see
+  /// RingBase::publish_every(). Producer only.
+  auto flush() -> void {
+    this->flush_head();
   }
 
   /// For reading values from the ringbuffer.
@@ -55,39 +80,95 @@ public:
   /// tail_ without incrementing it.
 
   auto read() -> std::optional<ValueType> {
-    const size_t lhead = head_.load(std::memory_order::acquire) & size_mask_;
-    const size_t ltail = tail_.load(std::memory_order::acquire) & size_mask_;
+    const size_t ltail = this->consumer_pos();
 
-    if(lhead == ltail)      /// buffer is empty.
-      return std::nullopt;  /// we can't read anything.
+    if(!this->can_consume(ltail)) /// buffer is empty.
+      return std::nullopt;        /// we can't read anything.
 
-    const ValueType val = buff_[ ltail ];
-    tail_.fetch_add(1, std::memory_order::release);
+    ValueType val = this->take(ltail);
+    this->publish_tail(ltail + 1);
     return val;
   }
 
+  /// Batch reads: fn is invoked on up to amnt elements in place,
+  /// oldest first, and tail_ is published once at the end. Returns
+  /// the number of elements consumed. fn gets a T& and mustn't throw.
+
+  template<typename F>
+  auto consume_up_to(const size_t amnt, F&& fn) -> size_t {
+    const size_t ltail = this->consumer_pos();
+    const size_t count = std::min(amnt, this->consumer_avail(ltail, amnt));
+    if(count == 0)
+      return 0;
+
+    this->consume_n(ltail, count, fn);
+    this->publish_tail(ltail + count);
+    return count;
+  }
+
+  template<typename F>
+  auto consume_all(F&& fn) -> size_t {
+    return consume_up_to(this->capacity(), std::forward<F>(fn));
+  }
+
+  /// Zero-copy access to the buffer's storage. reserve() returns up
+  /// to amnt writable slots at the head, published by commit().
+  /// read_span() returns every readable slot at the tail, which are
+  /// handed back by release(). reserve()/commit() are only
+  /// available for trivially copyable types.
+
+  NODISCARD_ auto reserve(size_t amnt) -> RingSpan<ValueType>
+  requires std::is_trivially_copyable_v<T> {
+    const size_t lhead = this->producer_pos();
+    const size_t count = std::min(amnt, this->producer_room(lhead, amnt));
+    return this->spans_at(lhead, count);
+  }
+
+  auto commit(size_t amnt) -> void
+  requires std::is_trivially_copyable_v<T> {
+    assert(amnt <= this->producer_room(this->producer_pos(), amnt));
+    this->publish_head(this->producer_pos() + amnt);
+  }
+
+  NODISCARD_ auto read_span() -> RingSpan<const ValueType> {
+    const size_t ltail = this->consumer_pos();
+    const size_t count = this->consumer_avail(ltail, this->capacity());
+    const auto spans   = this->spans_at(ltail, count);
+    return { spans.first, spans.second };
+  }
+
+  auto release(size_t amnt) -> void {
+    const size_t ltail = this->consumer_pos();
+    assert(amnt <= this->consumer_avail(ltail, amnt));
+    this->destroy(ltail, amnt);
+    this->publish_tail(ltail + amnt);
+  }
+
   NODISCARD_ auto try_current() const -> std::optional<ValueType> {
     const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+    const size_t ltail = this->consumer_pos();
 
-    if((lhead & size_mask_) == (ltail & size_mask_))
+    if(lhead == ltail)
       return std::nullopt;
 
-    return buff_[ ltail & size_mask_ ];
+    return this->slot(ltail);
   }
 
   NODISCARD_ auto current() const -> ValueType {
     const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+    const size_t ltail = this->consumer_pos();
 
-    if((lhead & size_mask_) == (ltail & size_mask_))
+    if(lhead == ltail)
       head_.wait(lhead, std::memory_order::acquire);
 
-    return buff_[ ltail & size_mask_ ];
+    return this->slot(ltail);
   }
 
  ~RingBuffer() = default;
   RingBuffer()  = default;
+
+  explicit RingBuffer(const size_t capacity, const StorageOptions opts = {})
+  requires RingBase<T, size_, Layout, Stats, batch_>::is_dynamic_ : RingBase<T, size_, Layout, Stats, batch_>(capacity, opts) {}
 };
 
 } //namespace rb
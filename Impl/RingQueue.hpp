@@ -7,50 +7,61 @@
 
 #include "Common.hpp"
 #include "RingBase.hpp"
+#include "Wait.hpp"
 #include <concepts>
 #include <utility>
 #include <optional>
+#include <algorithm>
+#include <span>
+#include <chrono>
+#include <expected>
+#include <type_traits>
 namespace rb {
 
-template<typename T, size_t size_>
-class RingQueue : public RingBase<T, size_> {
+/// Wait is one of the policies in Wait.hpp, and decides what
+/// the blocking operations do while the queue is full/empty.
+/// Layout is one of the policies in Layout.hpp, and Stats one of
+/// those in Stats.hpp. batch_ is RingBase's. RingTraits.hpp bundles
+/// all of these into one struct.
+
+template<typename T, size_t size_, typename Wait = BlockingWait,
+  typename Layout = DefaultLayout, typename Stats = NoStats, size_t batch_ = 1>
+class RingQueue : public RingBase<T, size_, Layout, Stats, batch_> {
 public:
-  using RingBase<T, size_>::head_;
-  using RingBase<T, size_>::tail_;
-  using RingBase<T, size_>::buff_;
-  using RingBase<T, size_>::can_mod_opt_;
-  using RingBase<T, size_>::size_mask_;
+  using RingBase<T, size_, Layout, Stats, batch_>::head_;
+  using RingBase<T, size_, Layout, Stats, batch_>::tail_;
+  using RingBase<T, size_, Layout, Stats, batch_>::can_mod_opt_;
+  using RingBase<T, size_, Layout, Stats, batch_>::size_mask_;
 
   using ValueType     = T;
   using ReferenceType = T&;
   using PointerType   = T*;
+  using WaitType      = Wait;
+
+  /// With stats enabled the policies also count the waits.
+  using WaitImpl = std::conditional_t<Stats::enabled_, CountedWait<Wait>, Wait>;
 
   template<typename ...Args> auto enqueue(Args&&... args) -> void {
     static_assert(std::constructible_from<T, Args...>);
-    const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+    const size_t lhead = this->producer_pos();
 
-    if( ((lhead + 1) & size_mask_) == (ltail & size_mask_) ) {
-      tail_.wait(ltail, std::memory_order::acquire);
-    }
-
-    buff_[ lhead & size_mask_ ] = T{std::forward<Args>(args)...};
-    head_.fetch_add(1, std::memory_order::release);
-    head_.notify_all();
+    not_full_.wait([&]{ return has_room(lhead); });
+    this->construct(lhead, std::forward<Args>(args)...);
+    if(this->publish_head(lhead + 1))
+      not_empty_.notify();
   }
 
   template<typename ...Args> auto try_enqueue(Args&&... args) -> bool {
     static_assert(std::constructible_from<T, Args...>);
-    const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+    const size_t lhead = this->producer_pos();
 
-    if(((lhead + 1) & size_mask_) == (ltail & size_mask_)) {
+    if(!has_room(lhead)) {
       return false;
     }
 
-    buff_[ lhead & size_mask_ ] = T{std::forward<Args>(args)...};
-    head_.fetch_add(1, std::memory_order::release);
-    head_.notify_all();
+    this->construct(lhead, std::forward<Args>(args)...);
+    if(this->publish_head(lhead + 1))
+      not_empty_.notify();
     return true;
   }
 
@@ -59,99 +70,341 @@ public:
   // element at the tail without dequeueing it.
 
   auto dequeue() -> ValueType {
-    constexpr auto read_order  = std::memory_order::acquire;
-    constexpr auto write_order = std::memory_order::release;
-    const size_t lhead = head_.load(read_order);
-    const size_t ltail = tail_.load(read_order);
+    const size_t ltail = this->consumer_pos();
 
-    if((lhead & size_mask_) == (ltail & size_mask_)) {
-      head_.wait(lhead, read_order);
-    }
-
-    const ValueType val = buff_[ tail_.load(read_order) & size_mask_ ];
-    tail_.fetch_add(1, write_order);
-    tail_.notify_all();
+    not_empty_.wait([&]{ return this->can_consume(ltail); });
+    ValueType val = this->take(ltail);
+    if(this->publish_tail(ltail + 1))
+      not_full_.notify();
     return val;
   }
 
   auto try_dequeue() -> std::optional<ValueType> {
-    const size_t lhead = head_.load(std::memory_order::acquire) & size_mask_;
-    const size_t ltail = tail_.load(std::memory_order::acquire) & size_mask_;
-    if(lhead == ltail) {   // the buffer is empty.
-      return std::nullopt; // we can't read anything.
+    const size_t ltail = this->consumer_pos();
+    if(!this->can_consume(ltail)) { // the buffer is empty.
+      return std::nullopt;          // we can't read anything.
     }
-    
-    const ValueType val = buff_[ ltail ];
-    tail_.fetch_add(1, std::memory_order::release);
-    tail_.notify_all();
+
+    ValueType val = this->take(ltail);
+    if(this->publish_tail(ltail + 1))
+      not_full_.notify();
     return val;
   }
 
-  NODISCARD_ auto try_current() const -> std::optional<ValueType> {
-    const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+  // Timed operations. These give up with RingStatus::timeout at the
+  // deadline, and with RingStatus::closed once close() was called:
+  // enqueues right away, dequeues once everything enqueued before
+  // that has been read. enqueue() and dequeue() don't watch for
+  // close(), pass time_point::max() here to wait forever but still
+  // return on shutdown.
 
-    if((lhead & size_mask_) == (ltail & size_mask_)) {
-      return std::nullopt;
+  template<typename Clock, typename Duration, typename ...Args>
+  auto enqueue_until(const std::chrono::time_point<Clock, Duration>& deadline, Args&&... args)
+  -> std::expected<void, RingStatus> {
+    static_assert(std::constructible_from<T, Args...>);
+    const size_t lhead = this->producer_pos();
+
+    not_full_.wait_until([&]{ return is_closed() || has_room(lhead); }, deadline);
+    if(is_closed())
+      return std::unexpected(RingStatus::closed);
+    if(!has_room(lhead))
+      return std::unexpected(RingStatus::timeout);
+
+    this->construct(lhead, std::forward<Args>(args)...);
+    if(this->publish_head(lhead + 1))
+      not_empty_.notify();
+    return {};
+  }
+
+  template<typename Rep, typename Period, typename ...Args>
+  auto enqueue_for(const std::chrono::duration<Rep, Period>& timeout, Args&&... args)
+  -> std::expected<void, RingStatus> {
+    return enqueue_until(std::chrono::steady_clock::now() + timeout, std::forward<Args>(args)...);
+  }
+
+  template<typename Clock, typename Duration>
+  auto dequeue_until(const std::chrono::time_point<Clock, Duration>& deadline)
+  -> std::expected<ValueType, RingStatus> {
+    const size_t ltail = this->consumer_pos();
+
+    const bool ready = not_empty_.wait_until([&]{ return this->can_consume(ltail) || is_closed(); }, deadline);
+    if(!this->can_consume(ltail))
+      return std::unexpected(ready ? RingStatus::closed : RingStatus::timeout);
+
+    ValueType val = this->take(ltail);
+    if(this->publish_tail(ltail + 1))
+      not_full_.notify();
+    return val;
+  }
+
+  template<typename Rep, typename Period>
+  auto dequeue_for(const std::chrono::duration<Rep, Period>& timeout)
+  -> std::expected<ValueType, RingStatus> {
+    return dequeue_until(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // Shuts the queue down and wakes up both sides. Elements already
+  // in the queue can still be dequeued. Can be called from any thread.
+  // Policies with a close() of their own get that called as well,
+  // e.g. CoroutineWait, which has suspended coroutines to release.
+  auto close() -> void {
+    closed_.store(true, std::memory_order::release);
+    wake_all();
+    if constexpr(requires { not_empty_.close(); }) {
+      not_empty_.close();
+      not_full_.close();
     }
+  }
 
-    return buff_[ ltail & size_mask_ ];
+  NODISCARD_ auto is_closed() const -> bool {
+    return closed_.load(std::memory_order::acquire);
   }
 
-  NODISCARD_ auto current() const -> ValueType {
+  // Bulk operations. The try_ variants move as many elements as
+  // currently fit (or are available) and return that count, the
+  // blocking variants wait until the whole span has been moved.
+  // Either way the index is published once per batch. mode picks
+  // how trivially copyable elements are stored, see Copy.hpp.
+
+  auto try_enqueue_bulk(std::span<const ValueType> src, const CopyMode mode = CopyMode::cached) -> size_t {
+    const size_t lhead = this->producer_pos();
+    const size_t count = std::min(src.size(), this->producer_room(lhead, src.size()));
+    if(count == 0) {
+      flush();
+      return 0;
+    }
+
+    this->copy_in(lhead, src.data(), count, mode);
+    if(this->publish_head(lhead + count))
+      not_empty_.notify();
+    return count;
+  }
+
+  auto try_dequeue_bulk(std::span<ValueType> dst) -> size_t {
+    const size_t ltail = this->consumer_pos();
+    const size_t count = std::min(dst.size(), this->consumer_avail(ltail, dst.size()));
+    if(count == 0) {
+      return 0;
+    }
+
+    this->move_out(ltail, dst.data(), count);
+    if(this->publish_tail(ltail + count))
+      not_full_.notify();
+    return count;
+  }
+
+  auto enqueue_bulk(std::span<const ValueType> src, const CopyMode mode = CopyMode::cached) -> void {
+    while(!src.empty()) {
+      src = src.subspan(try_enqueue_bulk(src, mode));
+      if(!src.empty()) {
+        const size_t lhead = this->producer_pos();
+        not_full_.wait([&]{ return has_room(lhead); });
+      }
+    }
+  }
+
+  auto dequeue_bulk(std::span<ValueType> dst) -> void {
+    while(!dst.empty()) {
+      dst = dst.subspan(try_dequeue_bulk(dst));
+      if(!dst.empty()) {
+        const size_t ltail = this->consumer_pos();
+        not_empty_.wait([&]{ return this->can_consume(ltail); });
+      }
+    }
+  }
+
+  // Batch consumption: fn is invoked on up to amnt elements in place,
+  // oldest first, and tail_ is published once at the end, so a whole
+  // batch costs a single index update (and notify). Returns the
+  // number of elements consumed. fn gets a T& and mustn't throw.
+  template<typename F>
+  auto consume_up_to(const size_t amnt, F&& fn) -> size_t {
+    const size_t ltail = this->consumer_pos();
+    const size_t count = std::min(amnt, this->consumer_avail(ltail, amnt));
+    if(count == 0) {
+      return 0;
+    }
+
+    this->consume_n(ltail, count, fn);
+    if(this->publish_tail(ltail + count))
+      not_full_.notify();
+    return count;
+  }
+
+  template<typename F>
+  auto consume_all(F&& fn) -> size_t {
+    return consume_up_to(this->capacity(), std::forward<F>(fn));
+  }
+
+  // Zero-copy access to the ring's storage. reserve() returns up to
+  // amnt writable slots at the head, which are published by commit().
+  // read_span() returns every readable slot at the tail, which are
+  // handed back to the producer by release(). Only the producer may
+  // call reserve()/commit() and only the consumer read_span()/release().
+  // Since reserved slots hold no object yet, reserve()/commit() are
+  // only available for trivially copyable types.
+
+  NODISCARD_ auto reserve(size_t amnt) -> RingSpan<ValueType>
+  requires std::is_trivially_copyable_v<T> {
+    const size_t lhead = this->producer_pos();
+    const size_t count = std::min(amnt, this->producer_room(lhead, amnt));
+    return this->spans_at(lhead, count);
+  }
+
+  auto commit(size_t amnt) -> void
+  requires std::is_trivially_copyable_v<T> {
+    assert(amnt <= this->producer_room(this->producer_pos(), amnt));
+    if(this->publish_head(this->producer_pos() + amnt))
+      not_empty_.notify();
+  }
+
+  NODISCARD_ auto read_span() -> RingSpan<const ValueType> {
+    const size_t ltail = this->consumer_pos();
+    const size_t count = this->consumer_avail(ltail, this->capacity());
+    const auto spans   = this->spans_at(ltail, count);
+    return { spans.first, spans.second };
+  }
+
+  auto release(size_t amnt) -> void {
+    const size_t ltail = this->consumer_pos();
+    assert(amnt <= this->consumer_avail(ltail, amnt));
+    this->destroy(ltail, amnt);
+    if(this->publish_tail(ltail + amnt))
+      not_full_.notify();
+  }
+
+  NODISCARD_ auto try_current() const -> std::optional<ValueType> {
     const size_t lhead = head_.load(std::memory_order::acquire);
-    const size_t ltail = tail_.load(std::memory_order::acquire);
+    const size_t ltail = this->consumer_pos();
 
-    if((lhead & size_mask_) == (ltail & size_mask_)) {
-      head_.wait(lhead, std::memory_order::acquire);
+    if(lhead == ltail) {
+      return std::nullopt;
     }
 
-    return buff_[ ltail & size_mask_ ];
+    return this->slot(ltail);
+  }
+
+  NODISCARD_ auto current() const -> ValueType {
+    const size_t ltail = this->consumer_pos();
+    not_empty_.wait([&]{ return head_.load(std::memory_order::acquire) != ltail; });
+    return this->slot(ltail);
   }
   
   NODISCARD_ auto can_peek(size_t amnt) -> bool {
-    const size_t lhead = head_.load(std::memory_order::acquire) & size_mask_;
-    const size_t ltail = tail_.load(std::memory_order::acquire) & size_mask_;
+    const size_t ltail = this->consumer_pos();
+    const size_t lhead = head_.load(std::memory_order::acquire);
 
-    assert(amnt < size_); // Amount must be less than buffer size
-    const size_t max_distance = lhead >= ltail
-      ? lhead - ltail
-      : (size_ - ltail) + lhead;
-    return amnt < max_distance;
+    assert(amnt < this->capacity()); // Amount must be less than buffer size
+    return amnt < lhead - ltail;
   }
   
   NODISCARD_ auto try_peek(size_t amnt) -> std::optional<ValueType> {
-    const size_t lhead = head_.load(std::memory_order::acquire) & size_mask_;
-    const size_t ltail = tail_.load(std::memory_order::acquire) & size_mask_;
+    const size_t ltail = this->consumer_pos();
+    const size_t lhead = head_.load(std::memory_order::acquire);
 
-    const size_t max_distance = lhead >= ltail
-      ? lhead - ltail
-      : (size_ - ltail) + lhead;
-    if(amnt >= max_distance) {
+    if(amnt >= lhead - ltail) {
       return std::nullopt;
     }
 
-    assert(amnt < size_); // Amount must be less than buffer size
-    assert(((ltail + amnt) & size_mask_) < size_); 
-    return buff_[ (ltail + amnt) & size_mask_ ];
+    assert(amnt < this->capacity()); // Amount must be less than buffer size
+    return this->slot(ltail + amnt);
   }
   
   NODISCARD_ auto peek(size_t amnt) -> ValueType {
-    const size_t ltail = tail_.load(std::memory_order::acquire) & size_mask_;
-    while(!can_peek(amnt))
-      head_.wait(head_.load(std::memory_order::acquire));
+    const size_t ltail = this->consumer_pos();
+    not_empty_.wait([&]{ return can_peek(amnt); });
 
-    return buff_[ (ltail + amnt) & size_mask_ ];
+    return this->slot(ltail + amnt);
   }
 
-  // wake any threads waiting on head_ or tail_, if any.
+  // The counters from RingBase::stats(), plus how often (and for how
+  // long) each side had to wait.
+  NODISCARD_ auto stats() const -> RingStatsSnapshot
+  requires Stats::enabled_ {
+    auto snap = RingBase<T, size_, Layout, Stats, batch_>::stats();
+    snap.producer_waits     = not_full_.waits();
+    snap.producer_wait_time = not_full_.wait_time();
+    snap.consumer_waits     = not_empty_.waits();
+    snap.consumer_wait_time = not_empty_.wait_time();
+    return snap;
+  }
+
+  // Publishes whatever the producer has pending, see
+  // RingBase::publish_every(). Producer only.
+  auto flush() -> void {
+    if(this->flush_head())
+      not_empty_.notify();
+  }
+
+  // The wait policies themselves: consumer_wait() is the one the
+  // consumer blocks on, producer_wait() the producer's. Mostly for
+  // policies with an interface of their own, e.g. EventFdWait::fd().
+  NODISCARD_ auto consumer_wait() -> WaitImpl& {
+    return not_empty_;
+  }
+
+  NODISCARD_ auto producer_wait() -> WaitImpl& {
+    return not_full_;
+  }
+
+  // wake any threads parked in the wait policy, if any.
   auto wake_all() -> void {
-    head_.notify_all();
-    tail_.notify_all();
+    not_empty_.wake();
+    not_full_.wake();
   }
   
  ~RingQueue() = default;
   RingQueue()  = default;
+
+  explicit RingQueue(const size_t capacity, const StorageOptions opts = {})
+  requires RingBase<T, size_, Layout, Stats, batch_>::is_dynamic_ : RingBase<T, size_, Layout, Stats, batch_>(capacity, opts) {}
+protected:
+  /// enqueue() and try_enqueue() without the notify, for queues made
+  /// of several RingQueues whose consumer blocks on a policy of their
+  /// own (PriorityRingQueue, ShardedQueue) and never on not_empty_.
+  /// Those notify theirs once the element is published.
+  template<typename ...Args> auto enqueue_quiet(Args&&... args) -> void {
+    static_assert(std::constructible_from<T, Args...>);
+    const size_t lhead = this->producer_pos();
+
+    not_full_.wait([&]{ return has_room(lhead); });
+    this->construct(lhead, std::forward<Args>(args)...);
+    this->publish_head(lhead + 1);
+  }
+
+  template<typename ...Args> auto try_enqueue_quiet(Args&&... args) -> bool {
+    static_assert(std::constructible_from<T, Args...>);
+    const size_t lhead = this->producer_pos();
+
+    if(!has_room(lhead)) {
+      return false;
+    }
+
+    this->construct(lhead, std::forward<Args>(args)...);
+    this->publish_head(lhead + 1);
+    return true;
+  }
+
+  /// can_produce() for RingQueue's own producer paths: with lazy
+  /// publication, whatever is pending is published before we report
+  /// the queue as full, since the consumer may be waiting on it.
+  NODISCARD_ auto has_room(const size_t lhead) -> bool {
+    if(this->can_produce(lhead))
+      return true;
+
+    flush();
+    return false;
+  }
+
+  /// not_empty_ is waited on by the consumer and notified by the
+  /// producer, not_full_ the other way around. These are mutable
+  /// since current() is const but may still block.
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) mutable WaitImpl not_empty_{};
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) mutable WaitImpl not_full_{};
+
+  /// Written once, read by both sides, so it gets its own block
+  /// rather than sitting on either side's line.
+  alignas(Layout::align_) std::atomic<bool> closed_{ false };
 };
 
 } //namespace rb
\ No newline at end of file
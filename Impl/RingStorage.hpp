@@ -0,0 +1,231 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include <memory>
+#include <new>
+#include <bit>
+#include <span>
+#include <numeric>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+#  if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <unistd.h>
+#  endif
+namespace rb {
+
+/// Pass as the size of a ring to pick its capacity at runtime.
+inline constexpr size_t dynamic_extent = std::dynamic_extent;
+
+/// Options for rings with a runtime capacity.
+struct StorageOptions {
+  /// Back the slots with 2MB pages (MAP_HUGETLB). If none are reserved
+  /// we fall back to regular pages with MADV_HUGEPAGE applied, so
+  /// transparent huge pages can still kick in. Linux only, ignored
+  /// elsewhere.
+  bool huge_pages = false;
+
+  /// Map the slots twice, back to back, so that slots()[i] and
+  /// slots()[i + capacity()] are the same memory and any range of
+  /// up to capacity() elements is contiguous. The capacity is
+  /// rounded up to a whole number of pages. Linux only (memfd),
+  /// throws std::bad_alloc elsewhere. Takes precedence over
+  /// huge_pages. See MirrorRing.hpp.
+  bool mirrored = false;
+
+  /// Place the slots on this NUMA node, which should usually be the
+  /// consumer's: it's the side that misses on them, the producer's
+  /// stores are buffered. -1 leaves it to the first write. Linux
+  /// only, best effort. See Numa.hpp.
+  int numa_node = -1;
+};
+
+/// Asks the kernel to place the pages covering [addr, addr + bytes)
+/// on node, migrating any that are already elsewhere. The policy is
+/// preferred rather than strict, so a node that runs out falls back
+/// to another one instead of failing the fault. Returns whether the
+/// kernel took it (e.g. not without NUMA support).
+inline auto bind_to_node(UNUSED_ const void* addr, UNUSED_ const size_t bytes, UNUSED_ const int node) -> bool {
+#  if defined(__linux__)
+  constexpr size_t max_nodes = 1024;
+  constexpr size_t word_bits = 8 * sizeof(unsigned long);
+  if(node < 0 || static_cast<size_t>(node) >= max_nodes || bytes == 0)
+    return false;
+
+  unsigned long mask[ max_nodes / word_bits ]{};
+  mask[node / word_bits] |= 1ul << (node % word_bits);
+
+  const auto page  = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+  const auto start = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);
+  const auto end   = reinterpret_cast<uintptr_t>(addr) + bytes;
+
+  /// maxnode counts one more bit than the kernel actually reads.
+  return ::syscall(SYS_mbind, start, end - start, MPOL_PREFERRED,
+    mask, max_nodes + 1, MPOL_MF_MOVE) == 0;
+#  else
+  return false;
+#  endif
+}
+
+/// The slot array of a ring. Slots are raw storage: elements are
+/// constructed in place when they're written and destroyed when
+/// they're read, so nothing is default-constructed up front. By
+/// default the array is embedded in the ring itself, with a
+/// capacity that's known at compile time.
+
+template<typename T, size_t size_>
+class RingStorage {
+public:
+  constexpr static size_t size_mask_ = size_ - 1;
+  constexpr static size_t align_ = alignof(T) > 64 ? alignof(T) : 64;
+
+  NODISCARD_ constexpr static auto capacity() -> size_t {
+    return size_;
+  }
+
+ ~RingStorage() = default;
+  RingStorage() = default;
+protected:
+  NODISCARD_ FORCEINLINE_ auto slots()       -> T*       { return reinterpret_cast<T*>(buff_); }
+  NODISCARD_ FORCEINLINE_ auto slots() const -> const T* { return reinterpret_cast<const T*>(buff_); }
+
+  alignas(align_) std::byte buff_[ size_ * sizeof(T) ];
+};
+
+/// Runtime capacity: the slots live in their own cache-line
+/// aligned allocation, optionally on huge pages. The capacity is
+/// rounded up to the next power of 2 so the mask fast path stays.
+
+template<typename T>
+class RingStorage<T, dynamic_extent> {
+public:
+  constexpr static size_t huge_page_size_ = size_t{ 1 } << 21;
+  constexpr static size_t align_ = alignof(T) > 64 ? alignof(T) : 64;
+
+  NODISCARD_ auto capacity() const -> size_t {
+    return size_mask_ + 1;
+  }
+
+  explicit RingStorage(const size_t capacity, const StorageOptions opts = {})
+    : size_mask_{ std::bit_ceil(opts.mirrored ? std::max(capacity, page_capacity()) : capacity) - 1 },
+      bytes_{ (size_mask_ + 1) * sizeof(T) } {
+    assert(capacity > 1); // Size must be greater than 1
+    buff_ = static_cast<std::byte*>(allocate(opts));
+  }
+
+ ~RingStorage() {
+    deallocate();
+  }
+
+  RingStorage(const RingStorage&)            = delete;
+  RingStorage& operator=(const RingStorage&) = delete;
+protected:
+  NODISCARD_ FORCEINLINE_ auto slots()       -> T*       { return reinterpret_cast<T*>(buff_); }
+  NODISCARD_ FORCEINLINE_ auto slots() const -> const T* { return reinterpret_cast<const T*>(buff_); }
+
+  /// The smallest power of 2 number of elements that fills
+  /// whole pages, which mirrored storage needs.
+  NODISCARD_ static auto page_capacity() -> size_t {
+#  if defined(__linux__)
+    const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return page / std::gcd(page, sizeof(T));
+#  else
+    return 2;
+#  endif
+  }
+
+  auto allocate(UNUSED_ const StorageOptions& opts) -> void* {
+#  if defined(__linux__)
+    if(opts.mirrored)
+      return map_mirrored(opts.numa_node);
+
+    /// Placement needs whole pages of our own, so it's mapped too.
+    if(opts.huge_pages || opts.numa_node >= 0) {
+      const auto unit = opts.huge_pages ? huge_page_size_ : static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      mapped_ = (bytes_ + unit - 1) & ~(unit - 1);
+      constexpr int prot  = PROT_READ | PROT_WRITE;
+      constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+      void* ptr = MAP_FAILED;
+      if(opts.huge_pages)
+        ptr = ::mmap(nullptr, mapped_, prot, flags | MAP_HUGETLB, -1, 0);
+      if(ptr == MAP_FAILED) {
+        ptr = ::mmap(nullptr, mapped_, prot, flags, -1, 0);
+        if(ptr == MAP_FAILED)
+          throw std::bad_alloc{};
+        if(opts.huge_pages)
+          ::madvise(ptr, mapped_, MADV_HUGEPAGE);
+      }
+
+      bind_to_node(ptr, mapped_, opts.numa_node);
+      return ptr;
+    }
+#  else
+    if(opts.mirrored)
+      throw std::bad_alloc{};
+#  endif
+    return ::operator new(bytes_, std::align_val_t{ align_ });
+  }
+
+#  if defined(__linux__)
+  /// Reserve twice the address space, then map the same memfd
+  /// over both halves of it.
+  auto map_mirrored(const int node) -> void* {
+    const int fd = ::memfd_create("rb-mirror", MFD_CLOEXEC);
+    if(fd < 0)
+      throw std::bad_alloc{};
+
+    void* base = MAP_FAILED;
+    if(::ftruncate(fd, static_cast<off_t>(bytes_)) == 0)
+      base = ::mmap(nullptr, 2 * bytes_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(base == MAP_FAILED) {
+      ::close(fd);
+      throw std::bad_alloc{};
+    }
+
+    constexpr int prot  = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_SHARED | MAP_FIXED;
+    auto* lower = static_cast<std::byte*>(base);
+    const bool ok = ::mmap(lower, bytes_, prot, flags, fd, 0) != MAP_FAILED
+      && ::mmap(lower + bytes_, bytes_, prot, flags, fd, 0) != MAP_FAILED;
+
+    ::close(fd);
+    if(!ok) {
+      ::munmap(base, 2 * bytes_);
+      throw std::bad_alloc{};
+    }
+
+    bind_to_node(lower, bytes_, node);  /// both halves are the same pages
+    mapped_ = 2 * bytes_;
+    return base;
+  }
+#  endif
+
+  auto deallocate() -> void {
+#  if defined(__linux__)
+    if(mapped_ != 0) {
+      ::munmap(buff_, mapped_);
+      return;
+    }
+#  endif
+    ::operator delete(buff_, std::align_val_t{ align_ });
+  }
+
+  size_t size_mask_;
+  size_t bytes_;
+  size_t mapped_{ 0 };  /// non-zero if buff_ came from mmap
+  std::byte* buff_{ nullptr };
+};
+
+} //namespace rb
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingQueue.hpp"
+#include "RingBuffer.hpp"
+#include "Layout.hpp"
+#include "Stats.hpp"
+#include "Wait.hpp"
+#include <concepts>
+#include <span>
+#include <cstddef>
+namespace rb {
+
+/// Every compile-time knob of a ring in one place, instead of a
+/// growing list of template parameters. Tune a queue by deriving
+/// and overriding just what differs:
+///
+///   struct TickTraits : RingTraits<4096, SpinParkWait<>> {
+///     constexpr static size_t publish_batch_ = 8;
+///   };
+///   RingQueueFor<Tick, TickTraits> ticks;
+///
+/// Everything is resolved with if constexpr, so a feature that's
+/// off (NoStats, publish_batch_ of 1) costs nothing on the hot path.
+///
+/// publish_batch_ is RingBase's batch_: 1 (the default) publishes
+/// every element, k > 1 every k (see RingBase::publish_every()), and
+/// runtime_batch leaves it to publish_every() at runtime. cache_budget_ is what the storage is
+/// expected to fit in, roughly a core's L2: going over it is a
+/// compile-time warning, not an error, since a ring much bigger than
+/// the cache can still be what's wanted (e.g. to absorb bursts).
+
+template<size_t size_ = dynamic_extent, typename Wait = BlockingWait,
+  typename Layout = DefaultLayout, typename Stats = NoStats>
+struct RingTraits {
+  constexpr static size_t capacity_       = size_;
+  constexpr static size_t publish_batch_  = 1;
+  constexpr static size_t cache_budget_   = size_t{ 1 } << 20;
+
+  using WaitType   = Wait;
+  using LayoutType = Layout;
+  using StatsType  = Stats;
+};
+
+template<typename C>
+concept RingConfig = requires {
+  { C::capacity_ }      -> std::convertible_to<size_t>;
+  { C::publish_batch_ } -> std::convertible_to<size_t>;
+  { C::cache_budget_ }  -> std::convertible_to<size_t>;
+  typename C::WaitType;
+  typename C::LayoutType;
+  typename C::StatsType;
+};
+
+namespace detail {
+  template<typename Traits>
+  [[deprecated("the ring's storage doesn't fit in Traits::cache_budget_")]]
+  constexpr auto over_cache_budget() -> void {}
+
+  /// Passes publish_batch_ through, checking the traits on the way.
+  template<typename T, RingConfig Traits>
+  consteval auto checked_batch() -> size_t {
+    static_assert(Traits::capacity_ == dynamic_extent || Traits::publish_batch_ <= Traits::capacity_,
+      "publish_batch_ can't be bigger than the capacity!");
+
+    if constexpr(Traits::capacity_ != dynamic_extent && Traits::capacity_ * sizeof(T) > Traits::cache_budget_)
+      over_cache_budget<Traits>();
+    return Traits::publish_batch_;
+  }
+} //namespace detail
+
+template<typename T, RingConfig Traits>
+using RingQueueFor = RingQueue<T, Traits::capacity_,
+  typename Traits::WaitType,
+  typename Traits::LayoutType,
+  typename Traits::StatsType,
+  detail::checked_batch<T, Traits>()>;
+
+/// Traits::WaitType goes unused here, RingBuffer never blocks.
+template<typename T, RingConfig Traits>
+using RingBufferFor = RingBuffer<T, Traits::capacity_,
+  typename Traits::LayoutType,
+  typename Traits::StatsType,
+  detail::checked_batch<T, Traits>()>;
+
+} //namespace rb
@@ -0,0 +1,135 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingBase.hpp"
+#include <atomic>
+#include <optional>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// A slot of a SeqRingBuffer. The payload is kept as relaxed
+/// atomic words, so a reader racing with the writer gets a torn
+/// copy (which it then throws away) rather than a data race.
+template<typename T>
+struct SeqSlot {
+  constexpr static size_t word_count_ = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<size_t> seq_{ 0 };
+  std::atomic<uint64_t> words_[ word_count_ ]{};
+};
+
+/// An overwriting ring where the writer never waits on the reader.
+/// Each slot carries a seqlock: it's odd while the slot is being
+/// written and 2 * (position + 1) once position's element is in it.
+/// The reader checks it before and after copying an element out; any
+/// mismatch means the writer lapped it, so it skips ahead to the
+/// oldest element that's still in the ring and retries. This is the
+/// safe alternative to RingBuffer::overwrite() with a live reader.
+/// One writer and one reader at a time.
+
+template<typename T, size_t size_, typename Layout = DefaultLayout>
+class SeqRingBuffer : protected RingBase<SeqSlot<T>, size_, Layout> {
+public:
+  using Base = RingBase<SeqSlot<T>, size_, Layout>;
+  using Base::head_;
+  using Base::tail_;
+  using Base::capacity;
+  using Base::is_empty;
+
+  using ValueType     = T;
+  using ReferenceType = T&;
+  using PointerType   = T*;
+
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable!");
+
+  /// Writes always succeed, overwriting the oldest element if the
+  /// buffer is full. Wait-free.
+  auto write(const ValueType& val) -> void {
+    const size_t lhead = head_.load(std::memory_order::relaxed);
+    auto& slot = this->slot(lhead);
+
+    uint64_t words[ SeqSlot<T>::word_count_ ]{};
+    std::memcpy(words, &val, sizeof(T));
+
+    slot.seq_.store(2 * lhead + 1, std::memory_order::relaxed);
+    std::atomic_thread_fence(std::memory_order::release);
+    for(size_t i = 0; i < SeqSlot<T>::word_count_; i++)
+      slot.words_[i].store(words[i], std::memory_order::relaxed);
+
+    slot.seq_.store(2 * lhead + 2, std::memory_order::release);
+    head_.store(lhead + 1, std::memory_order::release);
+  }
+
+  /// Reads the oldest element that hasn't been overwritten yet.
+  /// Elements the writer overwrote before we got to them are
+  /// skipped and counted in dropped().
+  auto read() -> std::optional<ValueType> {
+    size_t ltail = tail_.load(std::memory_order::relaxed);
+
+    for(;;) {
+      const size_t lhead = head_.load(std::memory_order::acquire);
+      if(ltail >= lhead)
+        return std::nullopt;
+
+      if(lhead - ltail > capacity()) {  /// we've been lapped, skip
+        skip_to(ltail, lhead - capacity());
+        continue;
+      }
+
+      auto& slot = this->slot(ltail);
+      const size_t before = slot.seq_.load(std::memory_order::acquire);
+      if(before != 2 * ltail + 2) {     /// overwritten since we loaded head_
+        skip_to(ltail, ltail + 1);
+        continue;
+      }
+
+      uint64_t words[ SeqSlot<T>::word_count_ ];
+      for(size_t i = 0; i < SeqSlot<T>::word_count_; i++)
+        words[i] = slot.words_[i].load(std::memory_order::relaxed);
+
+      std::atomic_thread_fence(std::memory_order::acquire);
+      if(slot.seq_.load(std::memory_order::relaxed) != before) {
+        skip_to(ltail, ltail + 1);      /// torn, the writer got here mid-copy
+        continue;
+      }
+
+      tail_.store(ltail + 1, std::memory_order::release);
+      alignas(T) std::byte raw[ sizeof(T) ];
+      std::memcpy(raw, words, sizeof(T));
+      return *std::launder(reinterpret_cast<T*>(raw));
+    }
+  }
+
+  /// The number of elements the reader lost to the writer so far.
+  NODISCARD_ auto dropped() const -> size_t {
+    return dropped_;
+  }
+
+ ~SeqRingBuffer() = default;
+  SeqRingBuffer() { init_slots(); }
+
+  explicit SeqRingBuffer(const size_t capacity, const StorageOptions opts = {})
+  requires Base::is_dynamic_ : Base(capacity, opts) { init_slots(); }
+protected:
+  auto skip_to(size_t& ltail, const size_t pos) -> void {
+    dropped_ += pos - ltail;
+    ltail     = pos;
+  }
+
+  auto init_slots() -> void {
+    for(size_t i = 0; i < capacity(); i++)
+      this->construct(i);
+  }
+
+  size_t dropped_{ 0 };  /// reader-local
+};
+
+} //namespace rb
@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingQueue.hpp"
+#include "Wait.hpp"
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+namespace rb {
+
+/// A group of shards_ RingQueues behind one facade, for many producers
+/// feeding a pool of consumers. Producer i always pushes to shard i,
+/// so the producer side is the plain SPSC protocol. Consumers start at
+/// their home shard (id % shards_) and, when that one is empty, steal
+/// from the others in turn. Since the shards only support one
+/// consumer at a time, each has a try-lock that a consumer holds while
+/// it drains: uncontended on the home shard, and a stealer simply
+/// moves on when it's taken. Pushes only notify ready_, the shards'
+/// own not_empty_ go unused: the consumer side of a shard mustn't be
+/// blocked on directly.
+
+template<typename T, size_t size_, size_t shards_,
+  typename Wait = BlockingWait, typename Layout = DefaultLayout>
+class ShardedQueue {
+public:
+  using ValueType = T;
+
+  /// A RingQueue whose pushes through us skip its not_empty_.
+  class ShardType : public RingQueue<T, size_, Wait, Layout> {
+    friend ShardedQueue;
+  };
+
+  static_assert(shards_ > 0, "need at least one shard!");
+
+  NODISCARD_ constexpr static auto shard_count() -> size_t {
+    return shards_;
+  }
+
+  /// Producer side. Each producer id may only be used by one thread.
+
+  template<typename ...Args>
+  auto try_push(const size_t producer, Args&&... args) -> bool {
+    assert(producer < shards_);
+    if(!shards_arr_[producer].queue_.try_enqueue_quiet(std::forward<Args>(args)...))
+      return false;
+
+    ready_.notify();
+    return true;
+  }
+
+  template<typename ...Args>
+  auto push(const size_t producer, Args&&... args) -> void {
+    assert(producer < shards_);
+    shards_arr_[producer].queue_.enqueue_quiet(std::forward<Args>(args)...);
+    ready_.notify();
+  }
+
+  /// Consumer side. Consumer ids are arbitrary, several threads
+  /// may share a home shard.
+
+  /// Invokes fn on up to amnt elements, all from one shard: the
+  /// consumer's own if it has any, otherwise the first one it can
+  /// steal from. Returns how many were consumed.
+  template<typename F>
+  auto pop_batch(const size_t consumer, const size_t amnt, F&& fn) -> size_t {
+    bool contended = false;
+    return drain(consumer, amnt, fn, contended);
+  }
+
+  auto try_pop(const size_t consumer) -> std::optional<ValueType> {
+    std::optional<ValueType> val;
+    pop_batch(consumer, 1, [&](T& elem) { val.emplace(std::move(elem)); });
+    return val;
+  }
+
+  /// Blocks until any shard has something for us. A shard another
+  /// consumer holds isn't waited on (its pops don't notify), we just
+  /// come back to it. The wait policy may check the condition again
+  /// after it held, hence val first.
+  auto pop(const size_t consumer) -> ValueType {
+    std::optional<ValueType> val;
+    bool contended = false;
+    const auto take = [&](T& elem) { val.emplace(std::move(elem)); };
+    const auto ready = [&]{
+      if(val.has_value())
+        return true;
+      contended = false;
+      drain(consumer, 1, take, contended);
+      return val.has_value() || contended;
+    };
+
+    for(;;) {
+      ready_.wait(ready);
+      if(val.has_value())
+        return std::move(*val);
+      std::this_thread::yield();
+    }
+  }
+
+  NODISCARD_ auto is_empty() const -> bool {
+    for(const auto& shard : shards_arr_) {
+      if(!shard.queue_.is_empty())
+        return false;
+    }
+    return true;
+  }
+
+  NODISCARD_ auto shard(const size_t id) -> ShardType& {
+    return shards_arr_[id].queue_;
+  }
+
+  auto wake_all() -> void {
+    ready_.wake();
+    for(auto& shard : shards_arr_)
+      shard.queue_.wake_all();
+  }
+
+ ~ShardedQueue() = default;
+  ShardedQueue()  = default;
+protected:
+  struct Shard {
+    ShardType queue_;
+    alignas(Layout::align_) std::atomic<bool> busy_{ false };  /// consumer try-lock
+  };
+
+  /// contended is set if a non-empty shard was skipped because
+  /// another consumer held it.
+  template<typename F>
+  auto drain(const size_t consumer, const size_t amnt, F& fn, bool& contended) -> size_t {
+    const size_t home = consumer % shards_;
+    for(size_t i = 0; i < shards_; i++) {
+      auto& shard = shards_arr_[(home + i) % shards_];
+      if(shard.queue_.is_empty())
+        continue;
+
+      if(shard.busy_.exchange(true, std::memory_order::acquire)) {
+        contended = true;
+        continue;
+      }
+
+      const size_t count = shard.queue_.consume_up_to(amnt, fn);
+      shard.busy_.store(false, std::memory_order::release);
+      if(count != 0)
+        return count;
+    }
+
+    return 0;
+  }
+
+  Shard shards_arr_[ shards_ ]{};
+
+  /// Notified by every push, waited on by pop() across all shards.
+  /// The only notify a push pays for.
+  NO_UNIQUE_ADDRESS_ alignas(Layout::align_) Wait ready_{};
+};
+
+} //namespace rb
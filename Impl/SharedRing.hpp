@@ -0,0 +1,216 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include <atomic>
+#include <expected>
+#include <system_error>
+#include <string>
+#include <thread>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#  if !defined(__linux__) && !defined(__APPLE__)
+#error "SharedRing.hpp needs shm_open() and mmap()."
+#  endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+namespace rb {
+
+/// Sits at the start of a shared mapping, in front of the ring.
+/// Whoever attaches checks it against its own idea of the ring's
+/// type before touching anything else.
+struct SharedHeader {
+  constexpr static uint64_t magic_   = 0x474e'4952'4d48'5352;  /// "RSHMRING"
+  constexpr static uint32_t version_ = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t elem_size;
+  uint64_t capacity;
+  uint64_t ring_size;
+  uint64_t ring_offset;
+  std::atomic<uint32_t> ready;  /// set last, once the ring is constructed
+
+  /// Whether this header describes a Ring placed at ring_off.
+  template<typename Ring>
+  NODISCARD_ auto describes(const size_t ring_off) const -> bool {
+    return magic       == magic_
+        && version     == version_
+        && elem_size   == sizeof(typename Ring::ValueType)
+        && capacity    == Ring::capacity()
+        && ring_size   == sizeof(Ring)
+        && ring_offset == ring_off;
+  }
+};
+
+/// Whether Ring can be used by several processes at once: it has to
+/// be free of pointers, which rules out runtime capacities and
+/// non-trivially-copyable elements, and its wait policy (if it has
+/// one) can't rely on process-private futexes.
+template<typename Ring>
+constexpr auto is_process_shared() -> bool {
+  if constexpr(Ring::is_dynamic_ || !std::is_trivially_copyable_v<typename Ring::ValueType>)
+    return false;
+  else if constexpr(requires { typename Ring::WaitType; })
+    return Ring::WaitType::process_shared_;
+  else
+    return true;
+}
+
+/// A ring placed in a POSIX shared memory object, e.g.
+///   SharedRing<RingQueue<Tick, 4096, FutexWait>>::create("/ticks")
+/// in one process and ::attach("/ticks") in the other. The object
+/// stays around until unlink() is called, like any shm_open() one.
+
+template<typename Ring>
+class SharedRing {
+public:
+  using RingType  = Ring;
+  using ValueType = typename Ring::ValueType;
+
+  static_assert(is_process_shared<Ring>(),
+    "the ring must have a fixed size, trivially copyable elements "
+    "and a process-shared wait policy (e.g. FutexWait)!");
+
+  constexpr static size_t ring_offset_ =
+    (sizeof(SharedHeader) + alignof(Ring) - 1) & ~(alignof(Ring) - 1);
+  constexpr static size_t map_size_ = ring_offset_ + sizeof(Ring);
+
+  /// Creates the shared memory object (which must not exist yet)
+  /// and constructs an empty ring in it.
+  NODISCARD_ static auto create(const std::string& name) -> std::expected<SharedRing, std::error_code> {
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0)
+      return std::unexpected(last_error());
+
+    if(::ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+      const auto err = last_error();
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      return std::unexpected(err);
+    }
+
+    auto mapped = map(fd);
+    if(!mapped) {
+      ::shm_unlink(name.c_str());
+      return std::unexpected(mapped.error());
+    }
+
+    SharedRing shared{ *mapped };
+    auto* header = ::new(shared.base_) SharedHeader{
+      SharedHeader::magic_,
+      SharedHeader::version_,
+      sizeof(ValueType),
+      Ring::capacity(),
+      sizeof(Ring),
+      ring_offset_,
+      { 0 }
+    };
+
+    shared.ring_ = ::new(static_cast<std::byte*>(shared.base_) + ring_offset_) Ring();
+    header->ready.store(1, std::memory_order::release);
+    return shared;
+  }
+
+  /// Attaches to a ring made by create(). Fails with
+  /// resource_unavailable_try_again if the creator isn't done
+  /// yet, and invalid_argument if the ring's type doesn't match.
+  NODISCARD_ static auto attach(const std::string& name) -> std::expected<SharedRing, std::error_code> {
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0)
+      return std::unexpected(last_error());
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < map_size_) {
+      ::close(fd);
+      return std::unexpected(std::make_error_code(std::errc::resource_unavailable_try_again));
+    }
+
+    auto mapped = map(fd);
+    if(!mapped)
+      return std::unexpected(mapped.error());
+
+    SharedRing shared{ *mapped };
+    if(const auto err = shared.validate())
+      return std::unexpected(err);
+
+    shared.ring_ = std::launder(reinterpret_cast<Ring*>(
+      static_cast<std::byte*>(shared.base_) + ring_offset_));
+    return shared;
+  }
+
+  static auto unlink(const std::string& name) -> std::error_code {
+    return ::shm_unlink(name.c_str()) == 0 ? std::error_code{} : last_error();
+  }
+
+  NODISCARD_ auto operator->() const -> Ring* { return ring_; }
+  NODISCARD_ auto operator*()  const -> Ring& { return *ring_; }
+
+  NODISCARD_ auto header() const -> const SharedHeader& {
+    return *std::launder(static_cast<const SharedHeader*>(base_));
+  }
+
+  SharedRing(SharedRing&& other) noexcept
+    : base_{ std::exchange(other.base_, nullptr) },
+      ring_{ std::exchange(other.ring_, nullptr) } {}
+
+  SharedRing& operator=(SharedRing&& other) noexcept {
+    if(this != &other) {
+      unmap();
+      base_ = std::exchange(other.base_, nullptr);
+      ring_ = std::exchange(other.ring_, nullptr);
+    }
+    return *this;
+  }
+
+ ~SharedRing() { unmap(); }
+protected:
+  explicit SharedRing(void* base) : base_{ base } {}
+
+  static auto last_error() -> std::error_code {
+    return { errno, std::system_category() };
+  }
+
+  /// Maps the whole object and closes fd either way.
+  static auto map(const int fd) -> std::expected<void*, std::error_code> {
+    void* base = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const auto err = last_error();
+    ::close(fd);
+
+    if(base == MAP_FAILED)
+      return std::unexpected(err);
+    return base;
+  }
+
+  auto validate() const -> std::error_code {
+    const auto& hdr = *std::launder(static_cast<const SharedHeader*>(base_));
+    for(size_t spins = 0; hdr.ready.load(std::memory_order::acquire) == 0; spins++) {
+      if(spins == 1024)
+        return std::make_error_code(std::errc::resource_unavailable_try_again);
+      std::this_thread::yield();
+    }
+
+    return hdr.describes<Ring>(ring_offset_)
+      ? std::error_code{} : std::make_error_code(std::errc::invalid_argument);
+  }
+
+  auto unmap() -> void {
+    if(base_ != nullptr)
+      ::munmap(base_, map_size_);
+  }
+
+  void* base_{ nullptr };
+  Ring* ring_{ nullptr };
+};
+
+} //namespace rb
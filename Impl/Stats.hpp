@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// Stats policies decide whether a ring keeps counters on its hot
+/// paths. NoStats (the default) compiles them out entirely; RingStats
+/// keeps a block per side, next to the state that side already owns,
+/// so counting never touches the other side's cache line. Every
+/// counter has a single writer, so updates are plain relaxed stores.
+
+/// A point-in-time copy of a ring's counters, see stats().
+struct RingStatsSnapshot {
+  size_t enqueued{ 0 };
+  size_t dequeued{ 0 };
+  size_t full_hits{ 0 };    /// checks that found no room, re-checks while waiting included
+  size_t empty_hits{ 0 };   /// checks that found nothing to read, same as above
+  size_t high_water{ 0 };   /// highest fill either side saw reloading the other's index, or stats() did
+  size_t producer_waits{ 0 };
+  size_t consumer_waits{ 0 };
+  std::chrono::nanoseconds producer_wait_time{ 0 };
+  std::chrono::nanoseconds consumer_wait_time{ 0 };
+};
+
+/// Bumps a counter that only the calling thread writes.
+FORCEINLINE_ auto bump(std::atomic<size_t>& counter, const size_t amnt = 1) -> void {
+  counter.store(counter.load(std::memory_order::relaxed) + amnt, std::memory_order::relaxed);
+}
+
+/// One side's full/empty hits, and the highest fill it has seen.
+struct SideStats {
+  std::atomic<size_t> hits_{ 0 };
+  std::atomic<size_t> high_water_{ 0 };
+};
+
+struct NoStats {
+  constexpr static bool enabled_ = false;
+  struct Side {};
+};
+
+struct RingStats {
+  constexpr static bool enabled_ = true;
+  using Side = SideStats;
+};
+
+/// Wraps a wait policy to count the waits that actually had to wait,
+/// and how long they took. The counters live in the policy itself,
+/// which is only ever waited on by one side.
+template<typename Wait>
+struct CountedWait : Wait {
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    if(ready())
+      return;
+
+    const Timer timer{ *this };
+    Wait::wait(ready);
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    if(ready())
+      return true;
+
+    const Timer timer{ *this };
+    return Wait::wait_until(ready, deadline);
+  }
+
+  NODISCARD_ auto waits() const -> size_t {
+    return waits_.load(std::memory_order::relaxed);
+  }
+
+  NODISCARD_ auto wait_time() const -> std::chrono::nanoseconds {
+    return std::chrono::nanoseconds{ wait_ns_.load(std::memory_order::relaxed) };
+  }
+
+protected:
+  struct Timer {
+    CountedWait& owner_;
+    std::chrono::steady_clock::time_point start_{ std::chrono::steady_clock::now() };
+
+   ~Timer() {
+      const auto took = std::chrono::steady_clock::now() - start_;
+      bump(owner_.waits_);
+      bump(owner_.wait_ns_, static_cast<size_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(took).count()));
+    }
+  };
+
+  std::atomic<size_t> waits_{ 0 };
+  std::atomic<size_t> wait_ns_{ 0 };
+};
+
+} //namespace rb
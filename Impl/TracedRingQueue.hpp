@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "RingQueue.hpp"
+#include "Latency.hpp"
+#include "Wait.hpp"
+#include <optional>
+#include <utility>
+#include <concepts>
+#include <chrono>
+#include <expected>
+#include <cstdint>
+#include <cstddef>
+namespace rb {
+
+/// A RingQueue that measures how long each element spent in it. Every
+/// slot carries a ticks() stamp next to the element, taken when the
+/// element is constructed in the slot (so time spent waiting for room
+/// doesn't count), and the consumer records now - stamp into a
+/// LatencyHistogram as it takes the element out. latency() can be
+/// called from any thread, e.g. a metrics exporter.
+///
+/// The cost is one counter read per side and a few relaxed stores
+/// on the consumer, plus 8 bytes per slot. Everything else behaves
+/// like the wrapped RingQueue, see queue() for the rest of its API.
+
+template<typename T, size_t size_, typename Wait = BlockingWait, typename Layout = DefaultLayout>
+class TracedRingQueue {
+public:
+  using ValueType = T;
+
+  struct Stamped {
+    T value_;
+    uint64_t stamp_;
+
+    template<typename ...Args>
+    explicit Stamped(std::in_place_t, Args&&... args)
+      : value_(std::forward<Args>(args)...), stamp_{ ticks() } {}
+  };
+
+  using QueueType = RingQueue<Stamped, size_, Wait, Layout>;
+
+  template<typename ...Args> auto enqueue(Args&&... args) -> void {
+    static_assert(std::constructible_from<T, Args...>);
+    queue_.enqueue(std::in_place, std::forward<Args>(args)...);
+  }
+
+  template<typename ...Args> auto try_enqueue(Args&&... args) -> bool {
+    static_assert(std::constructible_from<T, Args...>);
+    return queue_.try_enqueue(std::in_place, std::forward<Args>(args)...);
+  }
+
+  auto dequeue() -> ValueType {
+    return unwrap(queue_.dequeue());
+  }
+
+  auto try_dequeue() -> std::optional<ValueType> {
+    auto stamped = queue_.try_dequeue();
+    if(!stamped.has_value())
+      return std::nullopt;
+    return unwrap(std::move(*stamped));
+  }
+
+  template<typename Rep, typename Period>
+  auto dequeue_for(const std::chrono::duration<Rep, Period>& timeout)
+  -> std::expected<ValueType, RingStatus> {
+    auto stamped = queue_.dequeue_for(timeout);
+    if(!stamped.has_value())
+      return std::unexpected(stamped.error());
+    return unwrap(std::move(*stamped));
+  }
+
+  /// Queueing delay of everything dequeued so far, in ticks (see
+  /// LatencySnapshot::to_nanos()).
+  NODISCARD_ auto latency() const -> LatencySnapshot {
+    return latency_.snapshot();
+  }
+
+  NODISCARD_ auto is_empty() const -> bool {
+    return queue_.is_empty();
+  }
+
+  NODISCARD_ auto queue() -> QueueType& {
+    return queue_;
+  }
+
+  auto close() -> void {
+    queue_.close();
+  }
+
+  auto wake_all() -> void {
+    queue_.wake_all();
+  }
+
+ ~TracedRingQueue() = default;
+  TracedRingQueue()  = default;
+
+  explicit TracedRingQueue(const size_t capacity, const StorageOptions opts = {})
+  requires QueueType::is_dynamic_ : queue_(capacity, opts) {}
+protected:
+  /// A stamp from a core whose counter runs slightly behind
+  /// ours shows up as zero rather than wrapping around.
+  auto unwrap(Stamped&& stamped) -> ValueType {
+    const uint64_t now = ticks();
+    latency_.record(now > stamped.stamp_ ? now - stamped.stamp_ : 0);
+    return std::move(stamped.value_);
+  }
+
+  QueueType queue_{};
+  LatencyHistogram latency_{};  /// consumer-written
+};
+
+} //namespace rb
@@ -0,0 +1,319 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "Common.hpp"
+#include "Layout.hpp"
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <chrono>
+#include <algorithm>
+#include <ctime>
+
+#  if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <cerrno>
+#  endif
+namespace rb {
+
+/// Wait policies decide what a blocked producer or consumer does
+/// while it waits on the other side. A queue holds one instance per
+/// direction: wait(ready) returns once ready() is true, notify() is
+/// called by the other side after every publish, and wake() forces
+/// any parked thread to re-check its condition. wait_until(ready,
+/// deadline) gives up at deadline and returns ready() either way.
+/// process_shared_ says whether the policy still works when the
+/// queue lives in memory shared between processes (see SharedRing.hpp).
+
+/// Spins on the condition and never parks, so notify() is free.
+struct BusySpinWait {
+  constexpr static bool process_shared_ = true;
+
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    while(!ready())
+      CPU_RELAX_();
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    while(!ready()) {
+      if(Clock::now() >= deadline)
+        return ready();
+      CPU_RELAX_();
+    }
+    return true;
+  }
+
+  auto notify() -> void {}
+  auto wake()   -> void {}
+};
+
+/// Gives the rest of the timeslice away between checks.
+struct YieldWait {
+  constexpr static bool process_shared_ = true;
+
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    while(!ready())
+      std::this_thread::yield();
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    while(!ready()) {
+      if(Clock::now() >= deadline)
+        return ready();
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  auto notify() -> void {}
+  auto wake()   -> void {}
+};
+
+/// Parks the thread on an eventcount. Waiters announce themselves in
+/// waiters_ before re-checking the condition, so notify() only touches
+/// epoch_ (and the futex behind it) when a thread may actually be
+/// parked. On Linux epoch_ is a futex of our own, which is what makes
+/// timed waits possible (std::atomic::wait has no timeout), and with
+/// shared_ it isn't process-private, so producers and consumers in
+/// different processes can wake each other. Elsewhere the thread
+/// parks with std::atomic::wait and timed waits poll.
+
+template<bool shared_>
+struct alignas(destructive_size) EventCountWait {
+  constexpr static bool process_shared_ = shared_;
+
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    while(!ready()) {
+      const uint32_t key = prepare();
+      if(!ready())
+        park(key, nullptr);
+      waiters_.fetch_sub(1, std::memory_order::release);
+    }
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    while(!ready()) {
+      const auto left = deadline - Clock::now();
+      if(left <= decltype(left)::zero())
+        return ready();
+
+      const uint32_t key = prepare();
+      if(!ready()) {
+        /// Capped, so a far-off deadline (e.g. time_point::max()) can't overflow.
+        const auto capped = std::min<decltype(left)>(left, std::chrono::hours{ 24 });
+        const auto nanos  = std::chrono::duration_cast<std::chrono::nanoseconds>(capped);
+        park(key, &nanos);
+      }
+      waiters_.fetch_sub(1, std::memory_order::release);
+    }
+    return true;
+  }
+
+  auto notify() -> void {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if(waiters_.load(std::memory_order::relaxed) != 0)
+      wake();
+  }
+
+  auto wake() -> void {
+    epoch_.fetch_add(1, std::memory_order::release);
+#  if defined(__linux__)
+    futex(shared_ ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+#  else
+    epoch_.notify_all();
+#  endif
+  }
+
+protected:
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+  static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+  NODISCARD_ auto prepare() -> uint32_t {
+    const uint32_t key = epoch_.load(std::memory_order::acquire);
+    waiters_.fetch_add(1, std::memory_order::seq_cst);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    return key;
+  }
+
+  /// Returns once epoch_ moves past key, after timeout (if given),
+  /// or spuriously: callers re-check their condition either way.
+  auto park(const uint32_t key, const std::chrono::nanoseconds* timeout) -> void {
+#  if defined(__linux__)
+    timespec spec{};
+    if(timeout != nullptr) {
+      spec.tv_sec  = static_cast<time_t>(timeout->count() / 1'000'000'000);
+      spec.tv_nsec = static_cast<long>(timeout->count() % 1'000'000'000);
+    }
+    futex(shared_ ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, key, timeout ? &spec : nullptr);
+#  else
+    static_assert(!shared_, "process-shared waits need Linux futexes!");
+    if(timeout == nullptr)
+      epoch_.wait(key, std::memory_order::acquire);
+    else if(epoch_.load(std::memory_order::acquire) == key)
+      std::this_thread::sleep_for(std::min(*timeout, std::chrono::nanoseconds{ 50'000 }));
+#  endif
+  }
+
+#  if defined(__linux__)
+  auto futex(const int op, const uint32_t val, const timespec* timeout) -> void {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), op, val, timeout, nullptr, 0);
+  }
+#  endif
+
+  std::atomic<uint32_t> epoch_{ 0 };
+  std::atomic<uint32_t> waiters_{ 0 };
+};
+
+/// The default for every blocking ring.
+using BlockingWait = EventCountWait<false>;
+
+#  if defined(__linux__)
+/// BlockingWait for rings in shared memory.
+using FutexWait = EventCountWait<true>;
+#  endif
+
+#  if defined(__linux__)
+/// Signals an eventfd instead of parking on a futex, so a consumer
+/// can sleep on fd() in its own epoll/poll loop, next to sockets and
+/// other rings. The fd is written by the first notify() after the
+/// last reset() and not again until the next one, which in the usual
+/// loop (reset() once fd() polls readable, then drain until empty)
+/// means once per empty -> non-empty transition, not per element:
+///
+///   epoll_wait(...);                         /// fd() is readable
+///   queue.consumer_wait().reset();
+///   while(auto val = queue.try_dequeue()) ...
+///
+/// wait() and wait_until() poll the fd themselves, so the blocking
+/// operations still work. The fd is private to the process.
+
+struct alignas(destructive_size) EventFdWait {
+  constexpr static bool process_shared_ = false;
+
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    while(!ready()) {
+      reset();
+      if(!ready())
+        poll_fd(nullptr);
+    }
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    while(!ready()) {
+      const auto left = deadline - Clock::now();
+      if(left <= decltype(left)::zero())
+        return ready();
+
+      reset();
+      if(!ready()) {
+        const auto capped = std::min<decltype(left)>(left, std::chrono::hours{ 24 });
+        const auto nanos  = std::chrono::duration_cast<std::chrono::nanoseconds>(capped);
+        poll_fd(&nanos);
+      }
+    }
+    return true;
+  }
+
+  /// Pairs with the fence in reset(): either we see the flag
+  /// cleared and write the fd, or the waiter sees what we published.
+  auto notify() -> void {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if(signalled_.load(std::memory_order::relaxed))
+      return;
+    if(!signalled_.exchange(true, std::memory_order::acq_rel))
+      signal();
+  }
+
+  auto wake() -> void {
+    signalled_.store(true, std::memory_order::release);
+    signal();
+  }
+
+  /// Drains the fd and re-arms notify(). Call it before checking
+  /// the ring again, never after.
+  auto reset() -> void {
+    uint64_t count = 0;
+    UNUSED_ const auto got = ::read(fd_, &count, sizeof(count));
+    signalled_.store(false, std::memory_order::relaxed);
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+  }
+
+  /// Readable whenever there may be something to re-check.
+  NODISCARD_ auto fd() const -> int {
+    return fd_;
+  }
+
+  EventFdWait() : fd_{ ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) } {
+    if(fd_ < 0)
+      throw std::system_error{ errno, std::system_category(), "eventfd" };
+  }
+
+  EventFdWait(const EventFdWait&) = delete;
+  EventFdWait& operator=(const EventFdWait&) = delete;
+
+ ~EventFdWait() { ::close(fd_); }
+protected:
+  auto signal() -> void {
+    const uint64_t one = 1;
+    UNUSED_ const auto put = ::write(fd_, &one, sizeof(one));
+  }
+
+  /// Returns once the fd is readable, after timeout (if given),
+  /// or spuriously when interrupted.
+  auto poll_fd(const std::chrono::nanoseconds* timeout) -> void {
+    timespec spec{};
+    if(timeout != nullptr) {
+      spec.tv_sec  = static_cast<time_t>(timeout->count() / 1'000'000'000);
+      spec.tv_nsec = static_cast<long>(timeout->count() % 1'000'000'000);
+    }
+
+    pollfd pfd{ fd_, POLLIN, 0 };
+    ::ppoll(&pfd, 1, timeout ? &spec : nullptr, nullptr);
+  }
+
+  int fd_{ -1 };
+  std::atomic<bool> signalled_{ false };
+};
+#  endif
+
+/// Spins with a pause instruction for spins_ iterations before
+/// falling back to parking with Park (BlockingWait by default).
+template<size_t spins_ = 1024, typename Park = BlockingWait>
+struct SpinParkWait : Park {
+  template<typename Pred> auto wait(Pred&& ready) -> void {
+    if(!spin(ready))
+      Park::wait(ready);
+  }
+
+  template<typename Pred, typename Clock, typename Duration>
+  auto wait_until(Pred&& ready, const std::chrono::time_point<Clock, Duration>& deadline) -> bool {
+    return spin(ready) || Park::wait_until(ready, deadline);
+  }
+
+protected:
+  template<typename Pred> auto spin(Pred& ready) -> bool {
+    for(size_t i = 0; i < spins_; i++) {
+      if(ready())
+        return true;
+      CPU_RELAX_();
+    }
+    return false;
+  }
+};
+
+} //namespace rb
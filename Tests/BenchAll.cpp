@@ -0,0 +1,335 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include <benchmark/benchmark.h>
+
+#include "../Impl/RingBuffer.hpp"
+#include "../Impl/RingQueue.hpp"
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+
+#  if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#  endif
+using namespace rb;
+
+/// Where the producer and consumer threads run relative to each
+/// other. Passed as the first benchmark argument.
+enum class Placement : int64_t {
+  same_core    = 0,
+  sibling      = 1,  /// the other hyperthread of the same core
+  cross_core   = 2,  /// another physical core, same socket
+  cross_socket = 3,
+};
+
+/// A message of bytes_ bytes, with a sequence number up front
+/// so the consumer has something to check and depend on.
+template<size_t bytes_>
+struct Message {
+  static_assert(bytes_ >= sizeof(uint64_t));
+  uint64_t seq{};
+  std::byte pad[ bytes_ - sizeof(uint64_t) ]{};
+};
+
+namespace {
+
+auto read_topology(const int cpu, const char* entry) -> std::optional<int> {
+  const std::string path = "/sys/devices/system/cpu/cpu"
+    + std::to_string(cpu) + "/topology/" + entry;
+
+  std::ifstream file(path);
+  int value = 0;
+  if(!(file >> value))
+    return std::nullopt;
+  return value;
+}
+
+/// The RB_BENCH_CPUS="producer,consumer" environment variable,
+/// if it's set (and parses).
+auto override_cpus() -> std::optional<std::pair<int, int>> {
+  const char* env = std::getenv("RB_BENCH_CPUS");
+  int producer = 0, consumer = 0;
+  if(env == nullptr || std::sscanf(env, "%d,%d", &producer, &consumer) != 2)
+    return std::nullopt;
+  return std::pair{ producer, consumer };
+}
+
+/// Picks a (producer, consumer) pair of CPUs for the placement,
+/// based on the topology reported by sysfs. RB_BENCH_CPUS stands
+/// in for cross_core, for machines where sysfs gets that wrong:
+/// it should name two physical cores of the same socket. Since
+/// nothing says what else it could be, sibling and cross_socket
+/// don't run while it's set. same_core is always CPU 0.
+auto pick_cpus(const Placement placement) -> std::optional<std::pair<int, int>> {
+  if(placement == Placement::same_core)
+    return std::pair{ 0, 0 };
+
+  if(const auto cpus = override_cpus()) {
+    if(placement == Placement::cross_core)
+      return cpus;
+    return std::nullopt;
+  }
+
+  const int cpus      = static_cast<int>(std::thread::hardware_concurrency());
+  const auto core0    = read_topology(0, "core_id");
+  const auto package0 = read_topology(0, "physical_package_id");
+
+  for(int cpu = 1; cpu < cpus; cpu++) {
+    const auto core    = read_topology(cpu, "core_id");
+    const auto package = read_topology(cpu, "physical_package_id");
+    if(!core || !package || !core0 || !package0)
+      break;
+
+    const bool same_package = *package == *package0;
+    const bool same_core    = same_package && *core == *core0;
+    if((placement == Placement::sibling      && same_core)
+    || (placement == Placement::cross_core   && same_package && !same_core)
+    || (placement == Placement::cross_socket && !same_package))
+      return std::pair{ 0, cpu };
+  }
+
+  return std::nullopt;
+}
+
+auto pin_to(UNUSED_ const int cpu) -> void {
+#  if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#  endif
+}
+
+/// Spin a little while the other side catches up, then yield so
+/// that same_core runs can make progress at all.
+auto backoff(size_t& spins) -> void {
+  if(++spins < 64) {
+    CPU_RELAX_();
+  } else {
+    spins = 0;
+    std::this_thread::yield();
+  }
+}
+
+/// Runs producer on its own pinned thread while the benchmark
+/// thread (pinned as the consumer) runs consumer. The producer
+/// is handed a stop flag that it should check whenever it's
+/// waiting on the ring.
+template<typename Producer, typename Consumer>
+auto run_pair(benchmark::State& state, Producer&& producer, Consumer&& consumer) -> void {
+  const auto cpus = pick_cpus(static_cast<Placement>(state.range(0)));
+  if(!cpus) {
+    state.SkipWithError(override_cpus()
+      ? "RB_BENCH_CPUS is set, which only stands in for cross_core"
+      : "no CPUs match this placement");
+    return;
+  }
+
+  std::atomic<bool> stop{ false };
+  pin_to(cpus->second);
+  std::thread thread([&]() {
+    pin_to(cpus->first);
+    producer(stop);
+  });
+
+  consumer();
+  stop.store(true, std::memory_order::relaxed);
+  thread.join();
+}
+
+/// Reports latency percentiles over the recorded samples.
+auto report_percentiles(benchmark::State& state, std::vector<int64_t>& samples) -> void {
+  if(samples.empty())
+    return;
+
+  std::sort(samples.begin(), samples.end());
+  const auto at = [&](const double pct) {
+    const auto idx = static_cast<size_t>(pct * double(samples.size() - 1));
+    return static_cast<double>(samples[ idx ]);
+  };
+
+  state.counters["p50_ns"]  = at(0.50);
+  state.counters["p90_ns"]  = at(0.90);
+  state.counters["p99_ns"]  = at(0.99);
+  state.counters["p999_ns"] = at(0.999);
+  state.counters["max_ns"]  = static_cast<double>(samples.back());
+}
+
+} //namespace
+
+/// SPSC throughput, one element per operation.
+/// Arguments: placement, capacity.
+template<typename T>
+static void BM_QueueThroughput(benchmark::State& state) {
+  RingQueue<T, dynamic_extent, BusySpinWait> queue(static_cast<size_t>(state.range(1)));
+
+  run_pair(state, [&](std::atomic<bool>& stop) {
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      if(queue.try_enqueue(T{ seq }))
+        seq++;
+      else
+        backoff(spins);
+    }
+  }, [&]() {
+    size_t spins = 0;
+    for(auto _ : state) {
+      std::optional<T> val;
+      while(!(val = queue.try_dequeue()))
+        backoff(spins);
+      benchmark::DoNotOptimize(val->seq);
+    }
+  });
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * int64_t(sizeof(T)));
+}
+
+/// SPSC throughput with the bulk API, range(2) elements per batch.
+/// Arguments: placement, capacity, batch size.
+template<typename T>
+static void BM_QueueThroughputBulk(benchmark::State& state) {
+  RingQueue<T, dynamic_extent, BusySpinWait> queue(static_cast<size_t>(state.range(1)));
+  const auto batch = static_cast<size_t>(state.range(2));
+
+  run_pair(state, [&](std::atomic<bool>& stop) {
+    std::vector<T> src(batch);
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      for(auto& msg : src)
+        msg.seq = seq++;
+
+      std::span<const T> rest{ src };
+      while(!rest.empty() && !stop.load(std::memory_order::relaxed)) {
+        const size_t moved = queue.try_enqueue_bulk(rest);
+        rest = rest.subspan(moved);
+        if(moved == 0)
+          backoff(spins);
+      }
+    }
+  }, [&]() {
+    std::vector<T> dst(batch);
+    size_t spins = 0;
+    for(auto _ : state) {
+      std::span<T> rest{ dst };
+      while(!rest.empty()) {
+        const size_t moved = queue.try_dequeue_bulk(rest);
+        rest = rest.subspan(moved);
+        if(moved == 0)
+          backoff(spins);
+      }
+      benchmark::DoNotOptimize(dst.back().seq);
+    }
+  });
+
+  state.SetItemsProcessed(state.iterations() * state.range(2));
+  state.SetBytesProcessed(state.iterations() * state.range(2) * int64_t(sizeof(T)));
+}
+
+/// RingBuffer write()/read() throughput.
+/// Arguments: placement, capacity.
+template<typename T>
+static void BM_BufferThroughput(benchmark::State& state) {
+  RingBuffer<T, dynamic_extent> buffer(static_cast<size_t>(state.range(1)));
+
+  run_pair(state, [&](std::atomic<bool>& stop) {
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      if(buffer.write(T{ seq }))
+        seq++;
+      else
+        backoff(spins);
+    }
+  }, [&]() {
+    size_t spins = 0;
+    for(auto _ : state) {
+      std::optional<T> val;
+      while(!(val = buffer.read()))
+        backoff(spins);
+      benchmark::DoNotOptimize(val->seq);
+    }
+  });
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * int64_t(sizeof(T)));
+}
+
+/// Round trip latency: the benchmark thread sends a message on one
+/// queue and waits for the echo on another. Every round trip is
+/// recorded so we can report percentiles and not just the mean.
+/// Arguments: placement.
+template<typename T, typename Wait>
+static void BM_PingPong(benchmark::State& state) {
+  using clock = std::chrono::steady_clock;
+  RingQueue<T, 64, Wait> ping;
+  RingQueue<T, 64, Wait> pong;
+  std::vector<int64_t> samples;
+  samples.reserve(1 << 20);
+
+  run_pair(state, [&](std::atomic<bool>& stop) {
+    size_t spins = 0;
+    while(!stop.load(std::memory_order::relaxed)) {
+      if(auto msg = ping.try_dequeue())
+        pong.enqueue(*msg);
+      else
+        backoff(spins);
+    }
+  }, [&]() {
+    size_t spins = 0;
+    for(auto _ : state) {
+      const auto start = clock::now();
+      ping.enqueue(T{ 0 });
+
+      std::optional<T> msg;
+      while(!(msg = pong.try_dequeue()))
+        backoff(spins);
+      benchmark::DoNotOptimize(msg->seq);
+
+      const auto rtt = clock::now() - start;
+      if(samples.size() < samples.capacity())
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(rtt).count());
+    }
+  });
+
+  report_percentiles(state, samples);
+}
+
+static void PlacementArgs(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({ "placement", "capacity" });
+  for(int64_t placement = 0; placement <= 3; placement++)
+    for(int64_t capacity : { 64, 1024, 65536 })
+      bench->Args({ placement, capacity });
+}
+
+static void BulkArgs(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({ "placement", "capacity", "batch" });
+  for(int64_t placement = 0; placement <= 3; placement++)
+    for(int64_t batch : { 1, 16, 64, 256 })
+      bench->Args({ placement, 4096, batch });
+}
+
+BENCHMARK(BM_QueueThroughput<Message<8>>)->Apply(PlacementArgs)->UseRealTime();
+BENCHMARK(BM_QueueThroughput<Message<64>>)->Apply(PlacementArgs)->UseRealTime();
+BENCHMARK(BM_QueueThroughput<Message<256>>)->Apply(PlacementArgs)->UseRealTime();
+BENCHMARK(BM_QueueThroughputBulk<Message<8>>)->Apply(BulkArgs)->UseRealTime();
+BENCHMARK(BM_QueueThroughputBulk<Message<64>>)->Apply(BulkArgs)->UseRealTime();
+BENCHMARK(BM_BufferThroughput<Message<8>>)->Apply(PlacementArgs)->UseRealTime();
+BENCHMARK(BM_BufferThroughput<Message<64>>)->Apply(PlacementArgs)->UseRealTime();
+BENCHMARK(BM_PingPong<Message<8>, BusySpinWait>)->DenseRange(0, 3)->ArgName("placement")->UseRealTime();
+BENCHMARK(BM_PingPong<Message<64>, BusySpinWait>)->DenseRange(0, 3)->ArgName("placement")->UseRealTime();
+BENCHMARK(BM_PingPong<Message<8>, SpinParkWait<>>)->DenseRange(0, 3)->ArgName("placement")->UseRealTime();
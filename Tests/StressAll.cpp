@@ -0,0 +1,621 @@
+/*
+* Copyright (c) 2025 Diago Lima
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "../Impl/RingBuffer.hpp"
+#include "../Impl/RingQueue.hpp"
+#include "../Impl/RingTraits.hpp"
+#include "../Impl/MpmcRingQueue.hpp"
+#include "../Impl/BroadcastRing.hpp"
+#include "../Impl/MessageRing.hpp"
+#include "../Impl/ShardedQueue.hpp"
+#include "../Impl/PriorityRingQueue.hpp"
+#include "../Impl/TracedRingQueue.hpp"
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+using namespace rb;
+
+/// Runs producers and consumers at full speed against every ring,
+/// for a fixed time each, and checks what comes out the other end:
+/// every consumer has to see each producer's elements exactly once
+/// and in order, with their payload intact. The SPSC scenarios also
+/// fold what they saw into an order-sensitive digest, which has to
+/// match the one for 0, 1, ... n - 1, so all the index publication
+/// modes are held to the same ordering.
+///
+///   ringstress [seconds per scenario] [name filter]
+///
+/// Exits non-zero if any scenario fails. Build with RB_STRESS_TSAN
+/// to run it all under ThreadSanitizer. TSan doesn't model
+/// atomic_thread_fence, which EventCountWait, EventFdWait and the
+/// PriorityRingQueue and BroadcastRing wake-ups are built on, so
+/// scenarios that go through one of those print "not TSan-verified"
+/// there: TSan still checks their indices and slots, but a clean run
+/// says nothing about their parking and waking.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// splitmix64's finalizer.
+constexpr auto mix(uint64_t val) -> uint64_t {
+  val = (val ^ (val >> 30)) * 0xbf58476d1ce4e5b9ull;
+  val = (val ^ (val >> 27)) * 0x94d049bb133111ebull;
+  return val ^ (val >> 31);
+}
+
+/// What every scenario sends: a sequence number, and a value derived
+/// from it, so that a torn or stale slot can't pass for a good one.
+/// In the multi-producer scenarios the top bits say which producer.
+struct Payload {
+  uint64_t seq{ 0 };
+  uint64_t check{ 0 };
+
+  constexpr static uint64_t end_        = ~uint64_t{ 0 };  /// ends a stream
+  constexpr static size_t producer_shift_ = 48;
+
+  Payload() = default;
+  explicit Payload(const uint64_t n) : seq{ n }, check{ mix(n) } {}
+
+  NODISCARD_ auto valid() const -> bool { return check == mix(seq); }
+  NODISCARD_ auto is_end() const -> bool { return seq == end_; }
+  NODISCARD_ auto producer() const -> size_t { return static_cast<size_t>(seq >> producer_shift_); }
+  NODISCARD_ auto number() const -> uint64_t { return seq & ((uint64_t{ 1 } << producer_shift_) - 1); }
+
+  NODISCARD_ static auto from(const size_t producer, const uint64_t n) -> Payload {
+    return Payload{ (static_cast<uint64_t>(producer) << producer_shift_) | n };
+  }
+};
+
+/// One stream that has to arrive complete and in order.
+struct Checker {
+  uint64_t next{ 0 };
+  uint64_t digest{ 0xcbf29ce484222325ull };
+  std::string error{};
+
+  auto see(const Payload& val) -> void {
+    if(error.empty() && (!val.valid() || val.number() != next))
+      error = "expected " + std::to_string(next) + ", got " + std::to_string(val.number())
+        + (val.valid() ? "" : " (corrupt)");
+
+    digest = (digest ^ val.number()) * 0x100000001b3ull;
+    next++;
+  }
+};
+
+auto reference_digest(const uint64_t count) -> uint64_t {
+  Checker ref;
+  for(uint64_t i = 0; i < count; i++)
+    ref.see(Payload{ i });
+  return ref.digest;
+}
+
+/// Several producers' streams through one consumer: each producer's
+/// elements still have to show up in order, but may skip the ones
+/// other consumers took.
+struct Tally {
+  std::vector<uint64_t> next;
+  std::vector<uint64_t> counts;
+  std::string error{};
+
+  explicit Tally(const size_t producers) : next(producers, 0), counts(producers, 0) {}
+
+  auto see(const Payload& val) -> void {
+    const size_t id = val.producer();
+    if(!error.empty())
+      return;
+    if(!val.valid() || id >= next.size()) {
+      error = "corrupt element " + std::to_string(val.seq);
+      return;
+    }
+    if(val.number() < next[id]) {
+      error = "producer " + std::to_string(id) + ": " + std::to_string(val.number())
+        + " after " + std::to_string(next[id] - 1);
+      return;
+    }
+
+    next[id] = val.number() + 1;
+    counts[id]++;
+  }
+};
+
+struct Outcome {
+  uint64_t count{ 0 };
+  std::string error{};
+};
+
+auto backoff(size_t& spins) -> void {
+  if(++spins < 64) {
+    CPU_RELAX_();
+  } else {
+    spins = 0;
+    std::this_thread::yield();
+  }
+}
+
+/// Small, fast, and different sequences per seed.
+struct Rng {
+  uint64_t state;
+  auto below(const uint64_t bound) -> uint64_t {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state % bound;
+  }
+};
+
+/// Runs produce(stop) and consume(checker) on a thread each, stops
+/// the producer after time, and waits for the consumer to drain.
+/// The producer ends its stream with a Payload::end_ element.
+template<typename Produce, typename Consume>
+auto run_spsc(const Clock::duration time, Produce&& produce, Consume&& consume) -> Outcome {
+  std::atomic<bool> stop{ false };
+  Checker checker;
+
+  std::thread consumer([&]() { consume(checker); });
+  std::thread producer([&]() { produce(stop); });
+  std::this_thread::sleep_for(time);
+  stop.store(true, std::memory_order::relaxed);
+  producer.join();
+  consumer.join();
+
+  Outcome outcome{ checker.next, checker.error };
+  if(outcome.error.empty() && checker.digest != reference_digest(checker.next))
+    outcome.error = "digest doesn't match the reference ordering";
+  return outcome;
+}
+
+/// Element by element through any queue with enqueue()/dequeue().
+template<typename Queue>
+auto blocking_spsc(Queue& queue, const Clock::duration time) -> Outcome {
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed); seq++)
+      queue.enqueue(Payload{ seq });
+    queue.enqueue(Payload{ Payload::end_ });
+    if constexpr(requires { queue.flush(); })
+      queue.flush();
+  }, [&](Checker& checker) {
+    for(;;) {
+      const Payload val = queue.dequeue();
+      if(val.is_end())
+        return;
+      checker.see(val);
+    }
+  });
+}
+
+/// batch 1 is the default (eager) ring, anything else opts into
+/// publish_every() at runtime.
+template<size_t size_, typename Wait = BlockingWait>
+auto queue_with(const Clock::duration time, const size_t batch = 1) -> Outcome {
+  if(batch == 1) {
+    auto queue = std::make_unique<RingQueue<Payload, size_, Wait>>();
+    return blocking_spsc(*queue, time);
+  }
+
+  auto queue = std::make_unique<RingQueue<Payload, size_, Wait, DefaultLayout, NoStats, runtime_batch>>();
+  queue->publish_every(batch);
+  return blocking_spsc(*queue, time);
+}
+
+template<typename Traits>
+auto queue_for(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<RingQueueFor<Payload, Traits>>();
+  return blocking_spsc(*queue, time);
+}
+
+struct Batched16 : RingTraits<1024, SpinParkWait<>> {
+  constexpr static size_t publish_batch_ = 16;
+};
+
+struct Eager : RingTraits<1024, BusySpinWait, LinePairLayout, RingStats> {};
+
+auto queue_traced(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<TracedRingQueue<Payload, 1024>>();
+  return blocking_spsc(*queue, time);
+}
+
+/// Random sized bulk transfers on both sides, alternating copy modes.
+auto queue_bulk(const Clock::duration time, const size_t batch) -> Outcome {
+  auto queue = std::make_unique<RingQueue<Payload, 4096, SpinParkWait<>, DefaultLayout, NoStats, runtime_batch>>();
+  queue->publish_every(batch);
+
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    Rng rng{ 0x1234 };
+    std::vector<Payload> src(128);
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      const size_t count = 1 + rng.below(src.size());
+      for(size_t i = 0; i < count; i++)
+        src[i] = Payload{ seq++ };
+
+      const auto mode = rng.below(2) ? CopyMode::streaming : CopyMode::cached;
+      std::span<const Payload> rest{ src.data(), count };
+      while(!rest.empty()) {
+        const size_t moved = queue->try_enqueue_bulk(rest, mode);
+        rest = rest.subspan(moved);
+        if(moved == 0)
+          backoff(spins);
+      }
+    }
+    queue->enqueue(Payload{ Payload::end_ });
+    queue->flush();
+  }, [&](Checker& checker) {
+    Rng rng{ 0x4321 };
+    std::vector<Payload> dst(128);
+    size_t spins = 0;
+    for(;;) {
+      const size_t got = queue->try_dequeue_bulk(std::span{ dst.data(), 1 + rng.below(dst.size()) });
+      if(got == 0)
+        backoff(spins);
+      for(size_t i = 0; i < got; i++) {
+        if(dst[i].is_end())
+          return;
+        checker.see(dst[i]);
+      }
+    }
+  });
+}
+
+/// reserve()/commit() against read_span()/release().
+auto queue_zero_copy(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<RingQueue<Payload, 1024, YieldWait>>();
+
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    Rng rng{ 0x5678 };
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      const auto spans = queue->reserve(1 + rng.below(100));
+      for(auto& slot : spans.first)
+        slot = Payload{ seq++ };
+      for(auto& slot : spans.second)
+        slot = Payload{ seq++ };
+
+      queue->commit(spans.size());
+      if(spans.empty())
+        backoff(spins);
+    }
+    queue->enqueue(Payload{ Payload::end_ });
+  }, [&](Checker& checker) {
+    size_t spins = 0;
+    for(;;) {
+      const auto spans = queue->read_span();
+      for(const auto span : { spans.first, spans.second }) {
+        for(const Payload& val : span) {
+          if(val.is_end())
+            return;
+          checker.see(val);
+        }
+      }
+
+      queue->release(spans.size());
+      if(spans.empty())
+        backoff(spins);
+    }
+  });
+}
+
+auto queue_consume(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<RingQueue<Payload, 512, YieldWait, DefaultLayout, NoStats, 4>>();
+
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed); seq++)
+      queue->enqueue(Payload{ seq });
+    queue->enqueue(Payload{ Payload::end_ });
+    queue->flush();
+  }, [&](Checker& checker) {
+    bool done = false;
+    size_t spins = 0;
+    while(!done) {
+      const size_t got = queue->consume_up_to(64, [&](Payload& val) {
+        if(val.is_end())
+          done = true;
+        else if(!done)
+          checker.see(val);
+      });
+      if(got == 0)
+        backoff(spins);
+    }
+  });
+}
+
+template<typename Buffer>
+auto buffer_spsc(Buffer& buffer, const Clock::duration time) -> Outcome {
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    size_t spins = 0;
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed);) {
+      if(buffer.write(Payload{ seq }))
+        seq++;
+      else
+        backoff(spins);
+    }
+    while(!buffer.write(Payload{ Payload::end_ }))
+      backoff(spins);
+    buffer.flush();
+  }, [&](Checker& checker) {
+    size_t spins = 0;
+    for(;;) {
+      const auto val = buffer.read();
+      if(!val) {
+        backoff(spins);
+      } else if(val->is_end()) {
+        return;
+      } else {
+        checker.see(*val);
+      }
+    }
+  });
+}
+
+/// As queue_with(), batch 1 is the default ring.
+auto buffer_with(const Clock::duration time, const size_t batch) -> Outcome {
+  if(batch == 1) {
+    auto buffer = std::make_unique<RingBuffer<Payload, 256>>();
+    return buffer_spsc(*buffer, time);
+  }
+
+  auto buffer = std::make_unique<RingBuffer<Payload, 256, DefaultLayout, NoStats, runtime_batch>>();
+  buffer->publish_every(batch);
+  return buffer_spsc(*buffer, time);
+}
+
+/// Variable length records, each filled with bytes derived from
+/// its sequence number.
+auto message_spsc(const Clock::duration time) -> Outcome {
+  auto ring = std::make_unique<MessageRing<4096>>();
+  const auto fill = [](const uint64_t seq, const size_t i) {
+    return static_cast<std::byte>((seq + i) & 0xff);
+  };
+
+  return run_spsc(time, [&](std::atomic<bool>& stop) {
+    std::vector<std::byte> msg(ring->max_message());
+    size_t spins = 0;
+    for(uint64_t seq = 0;; seq++) {
+      const bool last = stop.load(std::memory_order::relaxed);
+      const uint64_t id = last ? Payload::end_ : seq;
+      const size_t len  = sizeof(id) + (last ? 0 : mix(seq) % (msg.size() - sizeof(id)));
+
+      std::memcpy(msg.data(), &id, sizeof(id));
+      for(size_t i = sizeof(id); i < len; i++)
+        msg[i] = fill(seq, i);
+      while(!ring->try_write(std::span{ msg.data(), len }))
+        backoff(spins);
+      if(last)
+        return;
+    }
+  }, [&](Checker& checker) {
+    size_t spins = 0;
+    for(;;) {
+      const auto msg = ring->try_read();
+      if(!msg) {
+        backoff(spins);
+        continue;
+      }
+
+      uint64_t id = 0;
+      std::memcpy(&id, msg->data(), sizeof(id));
+      if(id == Payload::end_)
+        return;
+
+      bool intact = msg->size() == sizeof(id) + mix(id) % (ring->max_message() - sizeof(id));
+      for(size_t i = sizeof(id); intact && i < msg->size(); i++)
+        intact = (*msg)[i] == fill(id, i);
+
+      Payload val{ id };
+      if(!intact)
+        val.check = ~val.check;
+      checker.see(val);
+      ring->release();
+    }
+  });
+}
+
+/// producers threads each push their own stream, consumers threads
+/// pop until they get an end marker. push(id, payload), pop(id) and
+/// empty() adapt the ring. The end markers only go in once the ring
+/// is drained, since consumers may take them from anywhere in it.
+template<typename Push, typename Pop, typename Empty>
+auto run_many(const Clock::duration time, const size_t producers, const size_t consumers,
+  Push&& push, Pop&& pop, Empty&& empty) -> Outcome {
+  std::atomic<bool> stop{ false };
+  std::vector<uint64_t> produced(producers, 0);
+  std::vector<Tally> tallies(consumers, Tally{ producers });
+
+  std::vector<std::thread> consuming;
+  for(size_t id = 0; id < consumers; id++) {
+    consuming.emplace_back([&, id]() {
+      for(;;) {
+        const Payload val = pop(id);
+        if(val.is_end())
+          return;
+        tallies[id].see(val);
+      }
+    });
+  }
+
+  std::vector<std::thread> producing;
+  for(size_t id = 0; id < producers; id++) {
+    producing.emplace_back([&, id]() {
+      uint64_t n = 0;
+      for(; !stop.load(std::memory_order::relaxed); n++)
+        push(id, Payload::from(id, n));
+      produced[id] = n;
+    });
+  }
+
+  std::this_thread::sleep_for(time);
+  stop.store(true, std::memory_order::relaxed);
+  for(auto& thread : producing)
+    thread.join();
+  for(size_t spins = 0; !empty();)
+    backoff(spins);
+  for(size_t id = 0; id < consumers; id++)
+    push(producers - 1, Payload{ Payload::end_ });
+  for(auto& thread : consuming)
+    thread.join();
+
+  Outcome outcome;
+  for(size_t p = 0; p < producers; p++) {
+    uint64_t seen = 0;
+    for(const auto& tally : tallies) {
+      if(outcome.error.empty() && !tally.error.empty())
+        outcome.error = tally.error;
+      seen += tally.counts[p];
+    }
+
+    outcome.count += seen;
+    if(outcome.error.empty() && seen != produced[p])
+      outcome.error = "producer " + std::to_string(p) + " sent " + std::to_string(produced[p])
+        + ", " + std::to_string(seen) + " arrived";
+  }
+  return outcome;
+}
+
+auto mpmc(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<MpmcRingQueue<Payload, 1024>>();
+  return run_many(time, 4, 4,
+    [&](size_t, const Payload& val) { queue->enqueue(val); },
+    [&](size_t) { return queue->dequeue(); },
+    [&]() { return queue->is_empty(); });
+}
+
+auto sharded(const Clock::duration time) -> Outcome {
+  auto group = std::make_unique<ShardedQueue<Payload, 256, 4>>();
+  return run_many(time, 4, 3,
+    [&](const size_t id, const Payload& val) { group->push(id, val); },
+    [&](const size_t id) { return group->pop(id); },
+    [&]() { return group->is_empty(); });
+}
+
+/// One producer per lane, each lane in order on its own.
+auto priority(const Clock::duration time) -> Outcome {
+  auto queue = std::make_unique<PriorityRingQueue<Payload, 256, 3>>();
+  return run_many(time, 3, 1,
+    [&](const size_t id, const Payload& val) { queue->enqueue(id, val); },
+    [&](size_t) { return queue->dequeue(); },
+    [&]() { return queue->is_empty(); });
+}
+
+/// Every reader has to see the whole stream.
+auto broadcast(const Clock::duration time) -> Outcome {
+  constexpr size_t readers = 3;
+  auto ring = std::make_unique<BroadcastRing<Payload, 1024, readers>>();
+  std::vector<size_t> ids;
+  for(size_t i = 0; i < readers; i++)
+    ids.push_back(ring->add_reader().value());
+
+  std::atomic<bool> stop{ false };
+  std::vector<Checker> checkers(readers);
+  std::vector<std::thread> reading;
+  for(size_t i = 0; i < readers; i++) {
+    reading.emplace_back([&, i]() {
+      for(;;) {
+        const Payload val = ring->read(ids[i]);
+        if(val.is_end())
+          return;
+        checkers[i].see(val);
+      }
+    });
+  }
+
+  std::thread writer([&]() {
+    for(uint64_t seq = 0; !stop.load(std::memory_order::relaxed); seq++)
+      ring->write(Payload{ seq });
+    ring->write(Payload{ Payload::end_ });
+  });
+
+  std::this_thread::sleep_for(time);
+  stop.store(true, std::memory_order::relaxed);
+  writer.join();
+  for(auto& thread : reading)
+    thread.join();
+
+  Outcome outcome{ checkers[0].next, {} };
+  for(const auto& checker : checkers) {
+    if(outcome.error.empty() && !checker.error.empty())
+      outcome.error = checker.error;
+    if(outcome.error.empty() && checker.next != outcome.count)
+      outcome.error = "readers saw different counts";
+  }
+  return outcome;
+}
+
+struct Scenario {
+  const char* name;
+  Outcome (*run)(Clock::duration);
+  bool fenced{ false };  /// waits or wakes through a fence, see above
+};
+
+const Scenario scenarios[] = {
+  { "queue/eager",            [](auto time) { return queue_with<1024>(time); }, true },
+  { "queue/publish_every(8)", [](auto time) { return queue_with<1024>(time, 8); }, true },
+  { "queue/publish_every(64)",[](auto time) { return queue_with<1024, SpinParkWait<>>(time, 64); }, true },
+  { "queue/tiny",             [](auto time) { return queue_with<2, YieldWait>(time); } },
+  { "queue/tiny_batched",     [](auto time) { return queue_with<4, YieldWait>(time, 3); } },
+  { "queue/traits_batch_16",  [](auto time) { return queue_for<Batched16>(time); }, true },
+  { "queue/traits_eager",     [](auto time) { return queue_for<Eager>(time); } },
+  { "queue/traced",           [](auto time) { return queue_traced(time); }, true },
+  { "queue/bulk",             [](auto time) { return queue_bulk(time, 1); }, true },
+  { "queue/bulk_batched",     [](auto time) { return queue_bulk(time, 32); }, true },
+  { "queue/zero_copy",        [](auto time) { return queue_zero_copy(time); } },
+  { "queue/consume_up_to",    [](auto time) { return queue_consume(time); } },
+#  if defined(__linux__)
+  { "queue/eventfd",          [](auto time) { return queue_with<1024, EventFdWait>(time); }, true },
+#  endif
+  { "buffer/eager",           [](auto time) { return buffer_with(time, 1); } },
+  { "buffer/publish_every(8)",[](auto time) { return buffer_with(time, 8); } },
+  { "message",                [](auto time) { return message_spsc(time); } },
+  { "mpmc",                   [](auto time) { return mpmc(time); }, true },
+  { "sharded",                [](auto time) { return sharded(time); }, true },
+  { "priority",               [](auto time) { return priority(time); }, true },
+  { "broadcast",              [](auto time) { return broadcast(time); }, true },
+};
+
+} //namespace
+
+auto main(const int argc, char** argv) -> int {
+  const double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+  const std::string_view filter = argc > 2 ? argv[2] : "";
+  const auto time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+#  if defined(RB_STRESS_TSAN)
+  constexpr bool tsan = true;
+#  else
+  constexpr bool tsan = false;
+#  endif
+
+  int failed = 0;
+  for(const auto& scenario : scenarios) {
+    if(!std::string_view{ scenario.name }.contains(filter))
+      continue;
+
+    const auto start   = Clock::now();
+    const auto outcome = scenario.run(time);
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const bool ok      = outcome.error.empty() && outcome.count != 0;
+
+    std::printf("%-26s %12llu elements %9.2f M/s  %s%s\n", scenario.name,
+      static_cast<unsigned long long>(outcome.count),
+      static_cast<double>(outcome.count) / elapsed / 1e6,
+      ok ? "ok" : "FAILED: ",
+      ok ? (tsan && scenario.fenced ? " (not TSan-verified)" : "")
+         : (outcome.error.empty() ? "nothing got through" : outcome.error.c_str()));
+    std::fflush(stdout);
+    failed += ok ? 0 : 1;
+  }
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
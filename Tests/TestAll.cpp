@@ -4,14 +4,40 @@
 */
 
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
 
 #define protected public
 #include "../Impl/RingBuffer.hpp"
 #include "../Impl/RingQueue.hpp"
+#include "../Impl/MpmcRingQueue.hpp"
+#include "../Impl/SeqRingBuffer.hpp"
+#include "../Impl/BroadcastRing.hpp"
+#include "../Impl/SharedRing.hpp"
+#include "../Impl/MirrorRing.hpp"
+#include "../Impl/MessageRing.hpp"
+#include "../Impl/AsyncRingQueue.hpp"
+#include "../Impl/ShardedQueue.hpp"
+#include "../Impl/PriorityRingQueue.hpp"
+#include "../Impl/TracedRingQueue.hpp"
+#include "../Impl/MappedRing.hpp"
+#include "../Impl/RingTraits.hpp"
+#include "../Impl/Numa.hpp"
 #undef protected
 
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <span>
+#include <deque>
+#include <coroutine>
+#include <sys/wait.h>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
 using namespace rb;
 
 TEST_CASE("BasicFunctionality", "[RingBuffer]") {
@@ -36,6 +62,7 @@ TEST_CASE("BasicFunctionality", "[RingBuffer]") {
     REQUIRE(buffer.write(1));
     REQUIRE(buffer.write(2));
     REQUIRE(buffer.write(3));
+    REQUIRE(buffer.write(4));
     REQUIRE(buffer.is_full());
 
     /// Overwrite should succeed even when full
@@ -69,7 +96,7 @@ TEST_CASE("BasicFunctionality", "[RingBuffer]") {
     REQUIRE(buffer.write(3));
 
     int total = 0;
-    for(int& val : buffer.buff_) {
+    for(int& val : std::span(buffer.data(), 3)) {
       total += val;
     }
 
@@ -83,7 +110,7 @@ TEST_CASE("BasicFunctionality", "[RingBuffer]") {
     REQUIRE(buffer.write(3));
 
     int total = 0;
-    for(const int& val : buffer.buff_) {
+    for(const int& val : buffer.read_span().first) {
       total += val;
     }
 
@@ -104,8 +131,10 @@ TEST_CASE("EdgeCases", "[RingBuffer]") {
     /// Fill the buffer
     REQUIRE(buffer.write(1));
     REQUIRE(buffer.write(2));
-    REQUIRE(buffer.write(3));   /// NOTE: 3/4 elements is a full buffer because of the
-    REQUIRE(buffer.is_full());  /// semantics wrt the indexes.
+    REQUIRE(buffer.write(3));
+    REQUIRE(!buffer.is_full());
+    REQUIRE(buffer.write(4));   /// NOTE: every slot is usable, since the indexes
+    REQUIRE(buffer.is_full());  /// are never wrapped.
     REQUIRE(!buffer.write(5));  /// Should fail when full
   }
 
@@ -253,3 +282,1735 @@ TEST_CASE("BlockingBehavior", "[RingQueue]") {
     REQUIRE(val == 2);
   }
 }
+
+TEST_CASE("CachedIndices", "[RingQueue]") {
+  SECTION("ProducerRefreshesOnlyWhenFull") {
+    RingQueue<int, 4> queue;
+    REQUIRE(queue.try_enqueue(1));
+    REQUIRE(queue.try_enqueue(2));
+    REQUIRE(queue.try_enqueue(3));
+    REQUIRE(queue.try_enqueue(4));
+    REQUIRE(queue.tail_cache_ == 0);
+
+    /// The consumer frees a slot, but the producer's cached
+    /// copy is only refreshed once it looks full.
+    REQUIRE(queue.try_dequeue().value() == 1);
+    REQUIRE(queue.tail_cache_ == 0);
+    REQUIRE(queue.try_enqueue(5));
+    REQUIRE(queue.tail_cache_ == 1);
+    REQUIRE(!queue.try_enqueue(6));
+  }
+
+  SECTION("ConsumerRefreshesOnlyWhenEmpty") {
+    RingQueue<int, 4> queue;
+    queue.enqueue(1);
+    queue.enqueue(2);
+
+    REQUIRE(queue.try_dequeue().value() == 1);
+    REQUIRE(queue.head_cache_ == 2);
+
+    queue.enqueue(3);
+    REQUIRE(queue.try_dequeue().value() == 2);
+    REQUIRE(queue.head_cache_ == 2);
+    REQUIRE(queue.try_dequeue().value() == 3);
+    REQUIRE(queue.head_cache_ == 3);
+    REQUIRE(!queue.try_dequeue().has_value());
+  }
+}
+
+TEST_CASE("BulkOperations", "[RingQueue]") {
+  SECTION("TryBulkPartial") {
+    RingQueue<int, 8> queue;
+    const int in[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    REQUIRE(queue.try_enqueue_bulk(in) == 8);
+    REQUIRE(queue.is_full());
+    REQUIRE(queue.try_enqueue_bulk(in) == 0);
+
+    int out[4]{};
+    REQUIRE(queue.try_dequeue_bulk(out) == 4);
+    REQUIRE(out[0] == 1);
+    REQUIRE(out[3] == 4);
+  }
+
+  SECTION("BulkWrapAround") {
+    RingQueue<int, 8> queue;
+    const int in[] = { 1, 2, 3, 4, 5, 6 };
+    int out[6]{};
+
+    /// Move the indices close to the end so the next batch wraps.
+    REQUIRE(queue.try_enqueue_bulk(in) == 6);
+    REQUIRE(queue.try_dequeue_bulk(out) == 6);
+
+    REQUIRE(queue.try_enqueue_bulk(in) == 6);
+    REQUIRE(queue.head_.load() == 12);
+    REQUIRE(queue.try_dequeue_bulk(out) == 6);
+    for(int i = 0; i < 6; i++) {
+      REQUIRE(out[i] == in[i]);
+    }
+
+    REQUIRE(queue.is_empty());
+    REQUIRE(queue.try_dequeue_bulk(out) == 0);
+  }
+
+  SECTION("BlockingBulk") {
+    RingQueue<int, 4> queue;
+    int in[64], out[64]{};
+    for(int i = 0; i < 64; i++) {
+      in[i] = i;
+    }
+
+    std::thread producer([&queue, &in]() {
+      queue.enqueue_bulk(in);
+    });
+
+    queue.dequeue_bulk(out);
+    producer.join();
+
+    for(int i = 0; i < 64; i++) {
+      REQUIRE(out[i] == i);
+    }
+  }
+}
+
+TEST_CASE("ZeroCopy", "[RingQueue]") {
+  SECTION("ReserveAndCommit") {
+    RingQueue<int, 8> queue;
+    auto spans = queue.reserve(3);
+    REQUIRE(spans.size() == 3);
+    REQUIRE(spans.second.empty());
+    REQUIRE(queue.is_empty()); /// Nothing is visible before commit()
+
+    spans.first[0] = 1;
+    spans.first[1] = 2;
+    spans.first[2] = 3;
+    queue.commit(3);
+
+    REQUIRE(queue.dequeue() == 1);
+    REQUIRE(queue.dequeue() == 2);
+    REQUIRE(queue.dequeue() == 3);
+  }
+
+  SECTION("ReserveWrapAround") {
+    RingQueue<int, 8> queue;
+    queue.commit(queue.reserve(6).size());
+    queue.release(queue.read_span().size());
+
+    /// Only 8 elements fit, and the range wraps after the 2nd one.
+    auto spans = queue.reserve(16);
+    REQUIRE(spans.size() == 8);
+    REQUIRE(spans.first.size() == 2);
+    REQUIRE(spans.second.size() == 6);
+    REQUIRE(spans.second.data() == queue.data());
+  }
+
+  SECTION("ReadSpanAndRelease") {
+    RingQueue<int, 4> queue;
+    REQUIRE(queue.read_span().empty());
+
+    queue.enqueue(1);
+    queue.enqueue(2);
+    auto spans = queue.read_span();
+    REQUIRE(spans.size() == 2);
+    REQUIRE(spans.first[0] == 1);
+    REQUIRE(spans.first[1] == 2);
+
+    queue.release(1);
+    REQUIRE(queue.try_current().value() == 2);
+    queue.release(1);
+    REQUIRE(queue.is_empty());
+  }
+}
+
+TEST_CASE("ZeroCopy", "[RingBuffer]") {
+  RingBuffer<int, 4> buffer;
+  auto spans = buffer.reserve(2);
+  REQUIRE(spans.size() == 2);
+  spans.first[0] = 1;
+  spans.first[1] = 2;
+  buffer.commit(2);
+
+  auto view = buffer.read_span();
+  REQUIRE(view.size() == 2);
+  REQUIRE(view.first[1] == 2);
+  buffer.release(2);
+  REQUIRE(buffer.is_empty());
+}
+
+TEMPLATE_TEST_CASE("WaitPolicies", "[RingQueue]",
+  BusySpinWait, YieldWait, BlockingWait, SpinParkWait<>)
+{
+  SECTION("BlockingDequeue") {
+    RingQueue<int, 4, TestType> queue;
+    std::thread producer([&queue]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      queue.enqueue(1);
+    });
+
+    REQUIRE(queue.dequeue() == 1);
+    producer.join();
+  }
+
+  SECTION("BlockingEnqueue") {
+    RingQueue<int, 4, TestType> queue;
+    bool in_order = true;
+    std::thread consumer([&queue, &in_order]() {
+      for(int i = 0; i < 32; i++) {
+        in_order = queue.dequeue() == i && in_order;
+      }
+    });
+
+    for(int i = 0; i < 32; i++) {
+      queue.enqueue(i);
+    }
+
+    consumer.join();
+    REQUIRE(in_order);
+    REQUIRE(queue.is_empty());
+  }
+}
+
+TEST_CASE("SkipNotifyWithoutWaiters", "[RingQueue]") {
+  RingQueue<int, 4, BlockingWait> queue;
+  queue.enqueue(1);
+  REQUIRE(queue.try_enqueue(2));
+  REQUIRE(queue.dequeue() == 1);
+  REQUIRE(queue.try_dequeue().value() == 2);
+
+  /// Nobody was ever parked, so the eventcounts were never bumped.
+  REQUIRE(queue.not_empty_.epoch_.load() == 0);
+  REQUIRE(queue.not_full_.epoch_.load() == 0);
+
+  queue.wake_all();
+  REQUIRE(queue.not_empty_.epoch_.load() == 1);
+}
+
+namespace {
+  /// Whether Ring has publish_every(), i.e. was made with runtime_batch.
+  template<typename Ring>
+  concept RuntimeBatch = requires(Ring& ring) { ring.publish_every(2); };
+}
+
+TEST_CASE("BasicFunctionality", "[MpmcRingQueue]") {
+  SECTION("UsesEverySlot") {
+    MpmcRingQueue<int, 4> queue;
+    static_assert(!RuntimeBatch<decltype(queue)>);  /// always publishes eagerly
+    REQUIRE(queue.is_empty());
+    for(int i = 0; i < 4; i++) {
+      REQUIRE(queue.try_enqueue(i));
+    }
+
+    REQUIRE(queue.is_full());
+    REQUIRE(!queue.try_enqueue(4));
+
+    for(int i = 0; i < 4; i++) {
+      REQUIRE(queue.try_dequeue().value() == i);
+    }
+
+    REQUIRE(queue.is_empty());
+    REQUIRE(!queue.try_dequeue().has_value());
+  }
+
+  SECTION("WrapAround") {
+    MpmcRingQueue<int, 4> queue;
+    for(int i = 0; i < 10; i++) {
+      queue.enqueue(i);
+      REQUIRE(queue.dequeue() == i);
+    }
+  }
+}
+
+TEST_CASE("MultipleProducersAndConsumers", "[MpmcRingQueue]") {
+  constexpr int threads    = 4;
+  constexpr int per_thread = 10000;
+  MpmcRingQueue<int, 64> queue;
+  std::atomic<long> total{ 0 };
+  std::vector<std::thread> pool;
+
+  for(int i = 0; i < threads; i++) {
+    pool.emplace_back([&queue]() {
+      for(int j = 1; j <= per_thread; j++) {
+        queue.enqueue(j);
+      }
+    });
+    pool.emplace_back([&queue, &total]() {
+      for(int j = 0; j < per_thread; j++) {
+        total.fetch_add(queue.dequeue(), std::memory_order::relaxed);
+      }
+    });
+  }
+
+  for(auto& thread : pool) {
+    thread.join();
+  }
+
+  REQUIRE(queue.is_empty());
+  REQUIRE(total.load() == long(threads) * per_thread * (per_thread + 1) / 2);
+}
+
+namespace {
+  /// Checks the condition once more after it held, which every wait
+  /// policy may do. BlockingWait only does it when a park races with
+  /// a notify, this makes it happen on every wait.
+  struct RecheckingWait : YieldWait {
+    template<typename Pred> auto wait(Pred&& ready) -> void {
+      YieldWait::wait(ready);
+      ready();
+    }
+  };
+}
+
+TEMPLATE_TEST_CASE("BlockingEachElementOnce", "[MpmcRingQueue]",
+  BlockingWait, RecheckingWait)
+{
+  /// Only one side blocks at a time, the other polls, so an
+  /// element enqueued twice can't cancel out one dropped.
+  bool blocking_enqueue = true;
+  SECTION("BlockingEnqueue") {}
+  SECTION("BlockingDequeue") { blocking_enqueue = false; }
+
+  constexpr int threads    = 4;
+  constexpr int per_thread = 5000;
+  constexpr int stop       = -1;
+  MpmcRingQueue<int, 4, TestType> queue;
+  std::vector<std::atomic<int>> seen(threads * per_thread);
+  std::vector<std::thread> producers, consumers;
+
+  const auto put = [&queue, blocking_enqueue](const int val) {
+    if(blocking_enqueue) {
+      queue.enqueue(val);
+      return;
+    }
+    while(!queue.try_enqueue(val)) {
+      std::this_thread::yield();
+    }
+  };
+
+  const auto take = [&queue, blocking_enqueue]() -> int {
+    if(!blocking_enqueue) {
+      return queue.dequeue();
+    }
+    for(;;) {
+      if(auto val = queue.try_dequeue()) {
+        return *val;
+      }
+      std::this_thread::yield();
+    }
+  };
+
+  for(int i = 0; i < threads; i++) {
+    producers.emplace_back([&put, i]() {
+      for(int j = 0; j < per_thread; j++) {
+        put(i * per_thread + j);
+      }
+    });
+    consumers.emplace_back([&take, &seen]() {
+      for(int val = take(); val != stop; val = take()) {
+        seen[val].fetch_add(1, std::memory_order::relaxed);
+      }
+    });
+  }
+
+  for(auto& thread : producers) {
+    thread.join();
+  }
+
+  /// One stop per consumer, plus spares where they fit so a lost one
+  /// can't hang the test: a loss still shows up in the counts below.
+  for(int i = 0; i < threads; i++) {
+    put(stop);
+    queue.try_enqueue(stop);
+  }
+
+  for(auto& thread : consumers) {
+    thread.join();
+  }
+
+  while(auto val = queue.try_dequeue()) {
+    REQUIRE(*val == stop);
+  }
+
+  REQUIRE(std::all_of(seen.begin(), seen.end(), [](auto& count){ return count.load() == 1; }));
+}
+
+TEST_CASE("DynamicCapacity", "[RingQueue]") {
+  SECTION("RoundsUpToPowerOfTwo") {
+    RingQueue<int, dynamic_extent> queue(100);
+    REQUIRE(queue.capacity() == 128);
+    REQUIRE(queue.is_empty());
+
+    for(int i = 0; i < 128; i++) {
+      REQUIRE(queue.try_enqueue(i));
+    }
+
+    REQUIRE(queue.is_full());
+    REQUIRE(!queue.try_enqueue(128));
+    for(int i = 0; i < 128; i++) {
+      REQUIRE(queue.dequeue() == i);
+    }
+  }
+
+  SECTION("HugePages") {
+    /// Falls back to regular pages if no huge pages are reserved.
+    RingQueue<int, dynamic_extent> queue(1 << 20, StorageOptions{ .huge_pages = true });
+    REQUIRE(queue.capacity() == (1 << 20));
+    REQUIRE(reinterpret_cast<uintptr_t>(queue.data()) % 64 == 0);
+
+    queue.enqueue(1);
+    queue.enqueue(2);
+    REQUIRE(queue.dequeue() == 1);
+    REQUIRE(queue.dequeue() == 2);
+  }
+}
+
+TEST_CASE("DynamicCapacity", "[RingBuffer]") {
+  RingBuffer<int, dynamic_extent> buffer(4);
+  REQUIRE(buffer.write(1));
+  REQUIRE(buffer.write(2));
+  REQUIRE(buffer.write(3));
+  REQUIRE(buffer.write(4));
+  REQUIRE(buffer.is_full());
+
+  buffer.overwrite(5);
+  REQUIRE(buffer.read().value() == 2);
+}
+
+TEST_CASE("FullQueue", "[RingQueue]") {
+  RingQueue<int, 4> queue;
+  for(int i = 1; i <= 4; i++) {
+    REQUIRE(queue.try_enqueue(i));
+  }
+
+  REQUIRE(queue.is_full());
+  REQUIRE(!queue.try_enqueue(5));
+
+  /// head and tail point at the same slot when full; make sure
+  /// nothing mistakes that for an empty queue.
+  REQUIRE(queue.try_current().value() == 1);
+  REQUIRE(queue.can_peek(3));
+  REQUIRE(queue.try_peek(3).value() == 4);
+  REQUIRE(queue.read_span().size() == 4);
+}
+
+TEST_CASE("NonTrivialElements", "[RingQueue]") {
+  SECTION("MoveOnly") {
+    RingQueue<std::unique_ptr<int>, 4> queue;
+    queue.enqueue(std::make_unique<int>(1));
+    REQUIRE(queue.try_enqueue(new int(2)));
+
+    auto first = queue.dequeue();
+    REQUIRE(*first == 1);
+    auto second = queue.try_dequeue();
+    REQUIRE(second.has_value());
+    REQUIRE(**second == 2);
+  }
+
+  SECTION("ConstructsInPlace") {
+    RingQueue<std::string, 4> queue;
+    queue.enqueue(3, 'a');
+    REQUIRE(queue.try_current().value() == "aaa");
+    REQUIRE(queue.dequeue() == "aaa");
+  }
+
+  SECTION("DestroysRemainingElements") {
+    auto tracker = std::make_shared<int>(0);
+    {
+      RingQueue<std::shared_ptr<int>, 4> queue;
+      queue.enqueue(tracker);
+      queue.enqueue(tracker);
+      queue.enqueue(tracker);
+      REQUIRE(tracker.use_count() == 4);
+
+      queue.dequeue();
+      REQUIRE(tracker.use_count() == 3);
+
+      /// release() destroys the slots it hands back.
+      queue.release(1);
+      REQUIRE(tracker.use_count() == 2);
+    }
+
+    REQUIRE(tracker.use_count() == 1);
+  }
+
+  SECTION("Bulk") {
+    RingQueue<std::string, 4> queue;
+    const std::string in[] = { "a", "b", "c" };
+    std::string out[3];
+    REQUIRE(queue.try_enqueue_bulk(in) == 3);
+    REQUIRE(queue.try_dequeue_bulk(out) == 3);
+    REQUIRE(out[2] == "c");
+  }
+}
+
+TEST_CASE("NonTrivialElements", "[RingBuffer]") {
+  auto tracker = std::make_shared<int>(0);
+  {
+    RingBuffer<std::shared_ptr<int>, 2> buffer;
+    REQUIRE(buffer.write(tracker));
+    REQUIRE(buffer.write(tracker));
+    REQUIRE(tracker.use_count() == 3);
+
+    /// The overwritten element is destroyed, not leaked.
+    buffer.overwrite(std::make_shared<int>(1));
+    REQUIRE(tracker.use_count() == 2);
+    REQUIRE(buffer.read().value() == tracker);
+  }
+
+  REQUIRE(tracker.use_count() == 1);
+}
+
+TEST_CASE("Layout", "[RingBase]") {
+  const auto distance = [](const auto& a, const auto& b) {
+    return static_cast<size_t>(reinterpret_cast<const std::byte*>(&b)
+      - reinterpret_cast<const std::byte*>(&a));
+  };
+
+  SECTION("DefaultLayout") {
+    RingQueue<int, 4> queue;
+    REQUIRE(distance(queue.head_, queue.tail_) >= destructive_size);
+    REQUIRE(distance(queue.head_, queue.tail_cache_) < destructive_size);
+    REQUIRE(distance(queue.tail_, queue.head_cache_) < destructive_size);
+    REQUIRE(sizeof(queue) % destructive_size == 0);
+  }
+
+  SECTION("LinePairLayout") {
+    RingQueue<int, 4, BusySpinWait, LinePairLayout> queue;
+    REQUIRE(distance(queue.data(), queue.head_) >= LinePairLayout::align_);
+    REQUIRE(distance(queue.head_, queue.tail_) == LinePairLayout::align_);
+    REQUIRE(alignof(decltype(queue)) == LinePairLayout::align_);
+    REQUIRE(sizeof(queue) % LinePairLayout::align_ == 0);
+
+    RingBuffer<int, 4, LinePairLayout> buffer;
+    REQUIRE(distance(buffer.head_, buffer.tail_) == LinePairLayout::align_);
+  }
+}
+
+TEST_CASE("BasicFunctionality", "[SeqRingBuffer]") {
+  SECTION("WriteAndRead") {
+    SeqRingBuffer<int, 4> buffer;
+    REQUIRE(buffer.is_empty());
+    REQUIRE(!buffer.read().has_value());
+
+    buffer.write(1);
+    buffer.write(2);
+    REQUIRE(buffer.read().value() == 1);
+    REQUIRE(buffer.read().value() == 2);
+    REQUIRE(!buffer.read().has_value());
+    REQUIRE(buffer.dropped() == 0);
+  }
+
+  SECTION("Overwrite") {
+    SeqRingBuffer<int, 4> buffer;
+    for(int i = 1; i <= 6; i++) {
+      buffer.write(i);
+    }
+
+    /// The two oldest were overwritten, and the reader knows it.
+    for(int i = 3; i <= 6; i++) {
+      REQUIRE(buffer.read().value() == i);
+    }
+
+    REQUIRE(buffer.dropped() == 2);
+    REQUIRE(!buffer.read().has_value());
+  }
+}
+
+TEST_CASE("ConcurrentOverwrite", "[SeqRingBuffer]") {
+  struct Sample {
+    uint64_t seq;
+    uint64_t check;
+    uint64_t pad[6];
+  };
+
+  constexpr uint64_t count = 200000;
+  SeqRingBuffer<Sample, 16> buffer;
+  std::atomic<bool> done{ false };
+
+  std::thread writer([&]() {
+    for(uint64_t i = 1; i <= count; i++) {
+      buffer.write(Sample{ i, ~i, {} });
+    }
+    done.store(true);
+  });
+
+  bool consistent = true;
+  uint64_t last = 0, reads = 0;
+  while(!done.load() || !buffer.is_empty()) {
+    if(auto sample = buffer.read()) {
+      consistent = consistent && sample->check == ~sample->seq && sample->seq > last;
+      last = sample->seq;
+      reads++;
+    }
+  }
+
+  writer.join();
+  REQUIRE(consistent);
+  REQUIRE(last == count);
+  REQUIRE(reads + buffer.dropped() == count);
+}
+
+TEST_CASE("BasicFunctionality", "[BroadcastRing]") {
+  SECTION("EveryReaderSeesEveryElement") {
+    BroadcastRing<int, 4, 2> ring;
+    const auto first  = ring.add_reader();
+    const auto second = ring.add_reader();
+    REQUIRE(first.has_value());
+    REQUIRE(second.has_value());
+    REQUIRE(!ring.add_reader().has_value());
+
+    REQUIRE(ring.try_write(1));
+    REQUIRE(ring.try_write(2));
+    REQUIRE(ring.try_read(*first).value() == 1);
+    REQUIRE(ring.try_read(*first).value() == 2);
+    REQUIRE(!ring.try_read(*first).has_value());
+    REQUIRE(ring.try_read(*second).value() == 1);
+    REQUIRE(ring.try_read(*second).value() == 2);
+    REQUIRE(ring.is_empty(*second));
+  }
+
+  SECTION("SlowestReaderGates") {
+    BroadcastRing<int, 4, 2> ring;
+    const auto fast = ring.add_reader().value();
+    const auto slow = ring.add_reader().value();
+
+    for(int i = 0; i < 4; i++) {
+      REQUIRE(ring.try_write(i));
+      REQUIRE(ring.try_read(fast).value() == i);
+    }
+
+    REQUIRE(!ring.try_write(4));
+    REQUIRE(ring.try_read(slow).value() == 0);
+    REQUIRE(ring.try_write(4));
+    REQUIRE(!ring.try_write(5));
+
+    /// Once the slow reader leaves, only the fast one gates.
+    ring.remove_reader(slow);
+    REQUIRE(ring.try_read(fast).value() == 4);
+    REQUIRE(ring.try_write(5));
+  }
+
+  SECTION("JoinsAtHead") {
+    BroadcastRing<int, 4, 1> ring;
+    for(int i = 0; i < 10; i++) {
+      REQUIRE(ring.try_write(i)); /// no readers, never full
+    }
+
+    const auto id = ring.add_reader().value();
+    REQUIRE(ring.is_empty(id));
+    ring.write(10);
+    REQUIRE(ring.read(id) == 10);
+  }
+
+  SECTION("ReadSpan") {
+    BroadcastRing<std::string, 4, 1> ring;
+    const auto id = ring.add_reader().value();
+    ring.write("a");
+    ring.write("b");
+
+    auto spans = ring.read_span(id);
+    REQUIRE(spans.size() == 2);
+    REQUIRE(spans.first[1] == "b");
+    ring.release(id, 2);
+    REQUIRE(ring.is_empty(id));
+  }
+}
+
+TEST_CASE("ConcurrentReaders", "[BroadcastRing]") {
+  constexpr int readers = 3;
+  constexpr int count   = 50000;
+  BroadcastRing<int, 64, readers> ring;
+  std::vector<std::thread> pool;
+  std::atomic<int> in_order{ 0 };
+
+  size_t ids[ readers ];
+  for(auto& id : ids) {
+    id = ring.add_reader().value();
+  }
+
+  for(const size_t id : ids) {
+    pool.emplace_back([&ring, &in_order, id]() {
+      bool ok = true;
+      for(int i = 0; i < count; i++) {
+        ok = ring.read(id) == i && ok;
+      }
+      in_order.fetch_add(ok ? 1 : 0);
+    });
+  }
+
+  for(int i = 0; i < count; i++) {
+    ring.write(i);
+  }
+
+  for(auto& thread : pool) {
+    thread.join();
+  }
+
+  REQUIRE(in_order.load() == readers);
+}
+
+TEST_CASE("AcrossProcesses", "[SharedRing]") {
+  using Queue  = RingQueue<int, 64, FutexWait>;
+  using Shared = SharedRing<Queue>;
+  const std::string name = "/rb-test-" + std::to_string(::getpid());
+  constexpr int count = 20000;
+
+  auto created = Shared::create(name);
+  REQUIRE(created.has_value());
+  REQUIRE(!Shared::create(name).has_value()); /// already exists
+  REQUIRE(!SharedRing<RingQueue<int, 32, FutexWait>>::attach(name).has_value());
+
+  const pid_t child = ::fork();
+  REQUIRE(child >= 0);
+  if(child == 0) {
+    auto attached = Shared::attach(name);
+    if(!attached)
+      ::_exit(1);
+    for(int i = 0; i < count; i++) {
+      (*attached)->enqueue(i);
+    }
+    ::_exit(0);
+  }
+
+  bool in_order = true;
+  for(int i = 0; i < count; i++) {
+    in_order = (*created)->dequeue() == i && in_order;
+  }
+
+  int status = 0;
+  REQUIRE(::waitpid(child, &status, 0) == child);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  REQUIRE(in_order);
+  REQUIRE((*created)->is_empty());
+  REQUIRE(!Shared::unlink(name));
+  REQUIRE(Shared::unlink(name) == std::errc::no_such_file_or_directory);
+}
+
+TEST_CASE("ContiguousWrap", "[MirrorRing]") {
+  MirrorRing<> ring{ 100 };
+  static_assert(!RuntimeBatch<decltype(ring)>);  /// commit() and release() publish
+  REQUIRE(ring.capacity() >= 4096);
+  REQUIRE(ring.capacity() % 4096 == 0);
+
+  const size_t cap = ring.capacity();
+  std::vector<std::byte> chunk(cap - 10);
+  std::vector<std::byte> out(cap);
+
+  SECTION("Aliasing") {
+    ring.data()[3] = std::byte{ 42 };
+    REQUIRE(ring.data()[cap + 3] == std::byte{ 42 });
+  }
+
+  SECTION("ReadsAcrossTheWrap") {
+    REQUIRE(ring.try_write(chunk));
+    REQUIRE(!ring.try_write(chunk));
+    REQUIRE(ring.try_read(out) == chunk.size());
+
+    for(size_t i = 0; i < chunk.size(); i++) {
+      chunk[i] = static_cast<std::byte>(i);
+    }
+
+    REQUIRE(ring.try_write(chunk));  /// wraps after 10 bytes
+    auto span = ring.read_span();
+    REQUIRE(span.size() == chunk.size());
+    REQUIRE(std::equal(span.begin(), span.end(), chunk.begin()));
+
+    ring.release(span.size());
+    REQUIRE(ring.is_empty());
+  }
+
+  SECTION("ReserveCommit") {
+    REQUIRE(ring.try_write(std::span{ out }.first(cap - 1)));
+    REQUIRE(ring.try_read(std::span{ out }.first(cap - 1)) == cap - 1);
+
+    auto span = ring.reserve(cap);
+    REQUIRE(span.size() == cap);
+    std::fill(span.begin(), span.end(), std::byte{ 7 });
+    ring.commit(cap);
+    REQUIRE(ring.is_full());
+
+    REQUIRE(ring.try_read(out) == cap);
+    REQUIRE(std::all_of(out.begin(), out.end(), [](auto b){ return b == std::byte{ 7 }; }));
+  }
+}
+
+TEST_CASE("BasicFunctionality", "[MessageRing]") {
+  MessageRing<64> ring;
+  static_assert(!RuntimeBatch<decltype(ring)>);  /// not even as a protected base
+  const auto bytes = [](const std::string& str) {
+    return std::as_bytes(std::span{ str.data(), str.size() });
+  };
+  const auto text = [](std::span<const std::byte> view) {
+    return std::string{ reinterpret_cast<const char*>(view.data()), view.size() };
+  };
+
+  SECTION("VariableLengths") {
+    REQUIRE(ring.max_message() == 24);
+    REQUIRE(ring.try_write(bytes("hi")));
+    REQUIRE(ring.try_write(bytes("")));
+    REQUIRE(ring.try_write(bytes("twelve bytes")));
+    REQUIRE(!ring.try_write(bytes(std::string(25, 'x'))));
+    REQUIRE(ring.head_.load() == 16 + 8 + 24);
+
+    REQUIRE(text(ring.try_read().value()) == "hi");
+    REQUIRE(text(ring.try_read().value()) == "hi"); /// not released yet
+    ring.release();
+    REQUIRE(ring.try_read().value().empty());
+    ring.release();
+    REQUIRE(text(ring.try_read().value()) == "twelve bytes");
+    ring.release();
+    REQUIRE(!ring.try_read().has_value());
+    REQUIRE(ring.is_empty());
+  }
+
+  SECTION("SkipsAtTheWrap") {
+    REQUIRE(ring.try_write(bytes(std::string(20, 'a')))); /// 32 bytes
+    REQUIRE(ring.try_write(bytes(std::string(16, 'b')))); /// 24 bytes, 8 left
+    REQUIRE(ring.try_read().has_value());
+    ring.release();
+
+    /// 24 byte record doesn't fit in the last 8: skip marker, then wrap.
+    REQUIRE(ring.try_write(bytes(std::string(10, 'c'))));
+    REQUIRE(ring.head_.load() == 56 + 8 + 24);
+
+    REQUIRE(text(ring.try_read().value()) == std::string(16, 'b'));
+    ring.release();
+    const auto view = ring.try_read().value();
+    REQUIRE(text(view) == std::string(10, 'c'));
+    REQUIRE(view.data() == ring.data() + 8);
+    ring.release();
+    REQUIRE(ring.is_empty());
+  }
+}
+
+TEST_CASE("Concurrent", "[MessageRing]") {
+  MessageRing<dynamic_extent> ring{ 256 };
+  constexpr int count = 50000;
+  bool in_order = true;
+
+  std::thread consumer([&]() {
+    for(int i = 0; i < count; i++) {
+      std::optional<std::span<const std::byte>> view;
+      while(!(view = ring.try_read())) {
+        std::this_thread::yield();
+      }
+
+      const std::string expected(static_cast<size_t>(i % 50), static_cast<char>('a' + i % 26));
+      in_order = std::string{ reinterpret_cast<const char*>(view->data()), view->size() } == expected && in_order;
+      ring.release();
+    }
+  });
+
+  for(int i = 0; i < count; i++) {
+    const std::string msg(static_cast<size_t>(i % 50), static_cast<char>('a' + i % 26));
+    while(!ring.try_write(std::as_bytes(std::span{ msg.data(), msg.size() }))) {
+      std::this_thread::yield();
+    }
+  }
+
+  consumer.join();
+  REQUIRE(in_order);
+}
+
+namespace {
+  /// Fire-and-forget coroutine, just enough to drive the awaitables.
+  struct Detached {
+    struct promise_type {
+      auto get_return_object() -> Detached { return {}; }
+      auto initial_suspend() -> std::suspend_never { return {}; }
+      auto final_suspend() noexcept -> std::suspend_never { return {}; }
+      auto return_void() -> void {}
+      auto unhandled_exception() -> void { std::terminate(); }
+    };
+  };
+
+  /// Collects scheduled coroutines so the test decides when they run.
+  struct ManualExecutor {
+    std::deque<std::coroutine_handle<>>* run_queue_{ nullptr };
+    auto schedule(std::coroutine_handle<> handle) const -> void {
+      run_queue_->push_back(handle);
+    }
+  };
+}
+
+TEST_CASE("Awaitables", "[AsyncRingQueue]") {
+  SECTION("SingleThreadedPipeline") {
+    std::deque<std::coroutine_handle<>> run_queue;
+    AsyncRingQueue<std::string, 4, ManualExecutor> queue{ ManualExecutor{ &run_queue } };
+    std::vector<std::string> received;
+    bool done = false;
+
+    auto consumer = [&]() -> Detached {
+      for(int i = 0; i < 20; i++) {
+        received.push_back((co_await queue.async_dequeue()).value());
+      }
+      done = true;
+    };
+
+    auto producer = [&]() -> Detached {
+      for(int i = 0; i < 20; i++) {
+        co_await queue.async_enqueue(std::to_string(i));
+      }
+    };
+
+    consumer();             /// suspends right away, the queue is empty
+    REQUIRE(run_queue.empty());
+    producer();             /// fills the queue up, then suspends
+    REQUIRE(queue.is_full());
+
+    while(!run_queue.empty()) {
+      auto handle = run_queue.front();
+      run_queue.pop_front();
+      handle.resume();
+    }
+
+    REQUIRE(done);
+    REQUIRE(received.size() == 20);
+    for(int i = 0; i < 20; i++) {
+      REQUIRE(received[i] == std::to_string(i));
+    }
+  }
+
+  SECTION("ResumedByBlockingProducer") {
+    constexpr int count = 20000;
+    AsyncRingQueue<int, 8> queue;
+    std::atomic<bool> done{ false };
+    bool in_order = true;
+
+    auto consumer = [&]() -> Detached {
+      for(int i = 0; i < count; i++) {
+        in_order = (co_await queue.async_dequeue()) == i && in_order;
+      }
+      done.store(true);
+    };
+
+    consumer();
+    std::thread producer([&]() {
+      for(int i = 0; i < count; i++) {
+        queue.enqueue(i);
+      }
+    });
+
+    producer.join();
+    REQUIRE(done.load());
+    REQUIRE(in_order);
+  }
+
+  SECTION("NonBlockingPark") {
+    /// YieldWait has no fence in notify(), CoroutineWait has to bring
+    /// its own. A lost wakeup leaves the consumer parked for good, so
+    /// the producer gives up rather than hanging the test.
+    using namespace std::chrono_literals;
+    constexpr int count = 20000;
+    AsyncRingQueue<int, 8, InlineExecutor, DefaultLayout, YieldWait> queue;
+    std::atomic<bool> done{ false };
+    bool in_order = true;
+
+    auto consumer = [&]() -> Detached {
+      for(int i = 0; i < count; i++) {
+        in_order = (co_await queue.async_dequeue()) == i && in_order;
+      }
+      done.store(true);
+    };
+
+    consumer();
+    std::thread producer([&]() {
+      const auto deadline = std::chrono::steady_clock::now() + 10s;
+      for(int i = 0; i < count; i++) {
+        while(!queue.try_enqueue(i) && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    producer.join();
+    REQUIRE(done.load());
+    REQUIRE(in_order);
+  }
+
+  SECTION("ReleasedByClose") {
+    std::deque<std::coroutine_handle<>> run_queue;
+    AsyncRingQueue<std::string, 4, ManualExecutor> queue{ ManualExecutor{ &run_queue } };
+    std::vector<std::expected<std::string, RingStatus>> received;
+    std::expected<void, RingStatus> sent;
+
+    auto consumer = [&]() -> Detached {
+      for(int i = 0; i < 3; i++) {
+        received.push_back(co_await queue.async_dequeue());
+      }
+    };
+
+    auto producer = [&]() -> Detached {
+      for(int i = 0; i < 5 && sent; i++) {
+        sent = co_await queue.async_enqueue(std::to_string(i));
+      }
+    };
+
+    producer();             /// four fit, the fifth suspends
+    REQUIRE(queue.is_full());
+    queue.close();
+    REQUIRE(run_queue.size() == 1);
+    run_queue.front().resume();
+    run_queue.pop_front();
+    REQUIRE(sent.error() == RingStatus::closed);
+
+    consumer();             /// drains what was there before close()
+    REQUIRE(received.size() == 3);
+    for(int i = 0; i < 3; i++) {
+      REQUIRE(received[i].value() == std::to_string(i));
+    }
+
+    received.clear();
+    consumer();             /// one left, then closed right away
+    REQUIRE(received.size() == 3);
+    REQUIRE(received[0].value() == "3");
+    REQUIRE(received[1].error() == RingStatus::closed);
+    REQUIRE(received[2].error() == RingStatus::closed);
+  }
+
+  SECTION("SuspendedConsumerReleasedByClose") {
+    std::deque<std::coroutine_handle<>> run_queue;
+    AsyncRingQueue<int, 4, ManualExecutor> queue{ ManualExecutor{ &run_queue } };
+    std::optional<std::expected<int, RingStatus>> received;
+
+    auto consumer = [&]() -> Detached {
+      received = co_await queue.async_dequeue();
+    };
+
+    consumer();             /// the queue is empty
+    REQUIRE(!received.has_value());
+    queue.close();
+    REQUIRE(run_queue.size() == 1);
+    run_queue.front().resume();
+    REQUIRE(received->error() == RingStatus::closed);
+  }
+}
+
+TEMPLATE_TEST_CASE("TimedOperations", "[RingQueue]",
+  BusySpinWait, YieldWait, BlockingWait, SpinParkWait<>) {
+  using namespace std::chrono_literals;
+  RingQueue<int, 2, TestType> queue;
+
+  SECTION("Timeout") {
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(queue.dequeue_for(5ms).error() == RingStatus::timeout);
+    REQUIRE(std::chrono::steady_clock::now() - start >= 5ms);
+
+    REQUIRE(queue.enqueue_for(5ms, 1).has_value());
+    REQUIRE(queue.enqueue_for(5ms, 2).has_value());
+    REQUIRE(queue.enqueue_for(5ms, 3).error() == RingStatus::timeout);
+    REQUIRE(queue.dequeue_for(5ms).value() == 1);
+  }
+
+  SECTION("WokenBeforeDeadline") {
+    std::thread producer([&]() {
+      std::this_thread::sleep_for(2ms);
+      queue.enqueue(42);
+    });
+
+    auto val = queue.dequeue_until(std::chrono::steady_clock::time_point::max());
+    producer.join();
+    REQUIRE(val.value() == 42);
+  }
+
+  SECTION("CloseWakesBlockedCallers") {
+    REQUIRE(queue.try_enqueue(1));
+    std::thread closer([&]() {
+      std::this_thread::sleep_for(2ms);
+      queue.close();
+    });
+
+    REQUIRE(queue.dequeue_for(10s).value() == 1);   /// drained first
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(queue.dequeue_for(10s).error() == RingStatus::closed);
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+    closer.join();
+
+    REQUIRE(queue.is_closed());
+    REQUIRE(queue.enqueue_for(10s, 2).error() == RingStatus::closed);
+  }
+}
+
+TEST_CASE("BatchConsume", "[RingQueue]") {
+  RingQueue<std::string, 8> queue;
+  for(int i = 0; i < 6; i++) {
+    queue.enqueue(std::to_string(i));
+  }
+
+  std::vector<std::string> seen;
+  const auto collect = [&](std::string& str) { seen.push_back(std::move(str)); };
+
+  REQUIRE(queue.consume_up_to(4, collect) == 4);
+  REQUIRE(queue.tail_.load() == 4);
+  REQUIRE(seen == std::vector<std::string>{ "0", "1", "2", "3" });
+
+  for(int i = 6; i < 12; i++) {
+    queue.enqueue(std::to_string(i)); /// wraps around
+  }
+
+  REQUIRE(queue.consume_all(collect) == 8);
+  REQUIRE(queue.consume_all(collect) == 0);
+  REQUIRE(queue.is_empty());
+  REQUIRE(seen.size() == 12);
+  REQUIRE(seen.back() == "11");
+}
+
+TEST_CASE("BatchConsume", "[RingBuffer]") {
+  RingBuffer<int, 4> buffer;
+  int sum = 0;
+  for(int i = 1; i <= 4; i++) {
+    REQUIRE(buffer.write(i));
+  }
+
+  REQUIRE(buffer.consume_all([&](int& val) { sum += val; }) == 4);
+  REQUIRE(sum == 10);
+  REQUIRE(buffer.is_empty());
+}
+
+TEST_CASE("Stats", "[RingQueue]") {
+  using namespace std::chrono_literals;
+  const auto distance = [](const auto& a, const auto& b) {
+    return static_cast<size_t>(reinterpret_cast<const std::byte*>(&b)
+      - reinterpret_cast<const std::byte*>(&a));
+  };
+
+  /// Without padding each side's block is just its fields, the stats
+  /// block last: NoStats has to take no room there, RingStats does.
+  using Packed = PaddedLayout<alignof(size_t)>;
+  STATIC_REQUIRE(std::is_empty_v<NoStats::Side>);
+  RingBuffer<int, 4, Packed, NoStats> plain;
+  RingBuffer<int, 4, Packed, RingStats> counted;
+  REQUIRE(distance(plain.head_, plain.tail_) == distance(plain.head_, plain.head_batch_) + sizeof(size_t));
+  REQUIRE(distance(counted.head_, counted.tail_) == distance(plain.head_, plain.tail_) + sizeof(SideStats));
+
+  RingQueue<int, 4, BlockingWait, DefaultLayout, RingStats> queue;
+  for(int i = 0; i < 4; i++) {
+    REQUIRE(queue.try_enqueue(i));
+  }
+
+  REQUIRE(!queue.try_enqueue(4));
+  auto snap = queue.stats();
+  REQUIRE(snap.enqueued == 4);
+  REQUIRE(snap.full_hits == 1);
+  REQUIRE(snap.high_water == 4);
+  REQUIRE(snap.producer_waits == 0);
+
+  int sum = 0;
+  REQUIRE(queue.consume_all([&](int& val) { sum += val; }) == 4);
+  REQUIRE(!queue.try_dequeue().has_value());
+
+  std::thread producer([&]() {
+    std::this_thread::sleep_for(2ms);
+    queue.enqueue(5);
+  });
+
+  REQUIRE(queue.dequeue() == 5);
+  producer.join();
+
+  snap = queue.stats();
+  REQUIRE(snap.dequeued == 5);
+  REQUIRE(snap.empty_hits >= 2);
+  REQUIRE(snap.consumer_waits == 1);
+  REQUIRE(snap.consumer_wait_time > 0ns);
+}
+
+TEST_CASE("HighWater", "[RingQueue]") {
+  RingQueue<int, 1024, BusySpinWait, DefaultLayout, RingStats> queue;
+  REQUIRE(queue.stats().high_water == 0);
+
+  for(int i = 0; i < 300; i++) {
+    REQUIRE(queue.try_enqueue(i));
+  }
+  REQUIRE(queue.stats().high_water == 300);   /// never came close to full
+
+  REQUIRE(queue.consume_all([](int&) {}) == 300);
+  for(int i = 0; i < 10; i++) {
+    REQUIRE(queue.try_enqueue(i));
+    REQUIRE(queue.try_dequeue().value() == i);
+  }
+
+  const auto snap = queue.stats();
+  REQUIRE(snap.high_water == 300);            /// kept after draining
+  REQUIRE(snap.full_hits == 0);
+}
+
+TEST_CASE("CopyKernels", "[Copy]") {
+  std::vector<std::byte> src(4096 + 64);
+  for(size_t i = 0; i < src.size(); i++) {
+    src[i] = static_cast<std::byte>(i * 7);
+  }
+
+  for(const auto mode : { CopyMode::cached, CopyMode::streaming }) {
+    for(const size_t bytes : { size_t{ 0 }, size_t{ 1 }, size_t{ 63 }, stream_threshold, size_t{ 4096 } }) {
+      for(const size_t offset : { 0, 1, 17, 32 }) {
+        std::vector<std::byte> dst(src.size(), std::byte{ 0 });
+        copy_bytes(dst.data() + offset, src.data() + 3, bytes, mode);
+        REQUIRE(std::equal(dst.begin() + offset, dst.begin() + offset + bytes, src.begin() + 3));
+        REQUIRE(std::all_of(dst.begin() + offset + bytes, dst.end(), [](auto b){ return b == std::byte{ 0 }; }));
+      }
+    }
+  }
+}
+
+TEST_CASE("StreamingBulk", "[RingQueue]") {
+  struct alignas(64) Tick { uint64_t words[8]; };
+  RingQueue<Tick, 64> queue;
+  std::vector<Tick> in(48), out(48);
+  for(size_t i = 0; i < in.size(); i++) {
+    in[i].words[0] = i;
+    in[i].words[7] = ~i;
+  }
+
+  for(int round = 0; round < 3; round++) { /// wraps on the second round
+    queue.enqueue_bulk(in, CopyMode::streaming);
+    queue.dequeue_bulk(out);
+    for(size_t i = 0; i < out.size(); i++) {
+      REQUIRE(out[i].words[0] == i);
+      REQUIRE(out[i].words[7] == ~i);
+    }
+  }
+}
+
+namespace {
+  /// Counts notify() calls, single-threaded tests only.
+  struct NotifyCounter : BusySpinWait {
+    auto notify() -> void { ++notified_; }
+    size_t notified_{ 0 };
+  };
+}
+
+TEST_CASE("BasicFunctionality", "[ShardedQueue]") {
+  ShardedQueue<int, 4, 3> group;
+  REQUIRE(group.is_empty());
+  REQUIRE(!group.try_pop(0).has_value());
+
+  REQUIRE(group.try_push(2, 7));
+  REQUIRE(group.try_pop(0).value() == 7); /// stolen from shard 2
+
+  group.push(0, 1);
+  group.push(1, 2);
+  REQUIRE(group.try_pop(1).value() == 2); /// home shard first
+  REQUIRE(group.try_pop(1).value() == 1);
+
+  for(int i = 0; i < 4; i++) {
+    REQUIRE(group.try_push(1, i));
+  }
+  REQUIRE(!group.try_push(1, 4));
+
+  int sum = 0;
+  REQUIRE(group.pop_batch(0, 8, [&](int& val) { sum += val; }) == 4);
+  REQUIRE(sum == 6);
+  REQUIRE(group.is_empty());
+}
+
+TEST_CASE("SingleNotify", "[ShardedQueue]") {
+  ShardedQueue<int, 4, 2, NotifyCounter> group;
+  REQUIRE(group.try_push(0, 1));
+  group.push(1, 2);
+  REQUIRE(group.ready_.notified_ == 2);
+  REQUIRE(group.shard(0).consumer_wait().notified_ == 0);
+  REQUIRE(group.shard(1).consumer_wait().notified_ == 0);
+  REQUIRE(group.pop(0) == 1);
+  REQUIRE(group.pop(0) == 2);
+}
+
+TEST_CASE("StealingConsumers", "[ShardedQueue]") {
+  constexpr size_t producers = 4;
+  constexpr size_t consumers = 3;
+  constexpr int count = 20000;
+  ShardedQueue<int, 64, producers> group;
+  std::atomic<long> sum{ 0 };
+  std::atomic<int> popped{ 0 };
+  std::vector<std::thread> pool;
+
+  for(size_t id = 0; id < consumers; id++) {
+    pool.emplace_back([&, id]() {
+      while(popped.fetch_add(1) < static_cast<int>(producers) * count) {
+        sum.fetch_add(group.pop(id));
+      }
+    });
+  }
+
+  for(size_t id = 0; id < producers; id++) {
+    pool.emplace_back([&, id]() {
+      for(int i = 1; i <= count; i++) {
+        group.push(id, i);
+      }
+    });
+  }
+
+  for(auto& thread : pool) {
+    thread.join();
+  }
+
+  REQUIRE(sum.load() == static_cast<long>(producers) * count * (count + 1) / 2);
+  REQUIRE(group.is_empty());
+}
+
+namespace {
+  /// Rings that take publish_every() at runtime, which is opt-in.
+  template<typename T, size_t size_>
+  using LazyQueue = RingQueue<T, size_, BlockingWait, DefaultLayout, NoStats, runtime_batch>;
+
+  template<typename T, size_t size_>
+  using LazyBuffer = RingBuffer<T, size_, DefaultLayout, NoStats, runtime_batch>;
+}
+
+TEST_CASE("LazyPublication", "[RingQueue]") {
+  SECTION("Batches") {
+    LazyQueue<int, 8> queue;
+    queue.publish_every(4);
+
+    for(int i = 0; i < 3; i++) {
+      REQUIRE(queue.try_enqueue(i));
+    }
+    REQUIRE(queue.head_.load() == 0);
+    REQUIRE(!queue.try_dequeue().has_value());
+
+    REQUIRE(queue.try_enqueue(3));    /// a whole batch
+    REQUIRE(queue.head_.load() == 4);
+    REQUIRE(queue.try_enqueue(4));
+    queue.flush();
+    REQUIRE(queue.head_.load() == 5);
+
+    REQUIRE(queue.dequeue() == 0);
+    REQUIRE(queue.dequeue() == 1);
+    REQUIRE(queue.tail_.load() == 0);
+    std::vector<int> rest(3);
+    REQUIRE(queue.try_dequeue_bulk(rest) == 3);
+    REQUIRE(rest == std::vector<int>{ 2, 3, 4 });
+    REQUIRE(queue.tail_.load() == 5); /// ran empty
+  }
+
+  SECTION("FullFlushes") {
+    LazyQueue<int, 4> queue;
+    queue.publish_every(8);           /// more than fits
+    for(int i = 0; i < 4; i++) {
+      REQUIRE(queue.try_enqueue(i));
+    }
+
+    REQUIRE(queue.head_.load() == 0);
+    REQUIRE(!queue.try_enqueue(4));
+    REQUIRE(queue.head_.load() == 4);
+  }
+
+  SECTION("Concurrent") {
+    constexpr int count = 100000;
+    LazyQueue<int, 16> queue;
+    queue.publish_every(8);
+    bool in_order = true;
+
+    std::thread consumer([&]() {
+      for(int i = 0; i < count; i++) {
+        in_order = queue.dequeue() == i && in_order;
+      }
+    });
+
+    for(int i = 0; i < count; i++) {
+      queue.enqueue(i);
+    }
+
+    queue.flush();
+    consumer.join();
+    REQUIRE(in_order);
+    REQUIRE(queue.tail_.load() == count);
+  }
+
+  SECTION("RingBuffer") {
+    LazyBuffer<int, 4> buffer;
+    buffer.publish_every(2);
+    REQUIRE(buffer.write(1));
+    REQUIRE(!buffer.read().has_value());
+    buffer.flush();
+    REQUIRE(buffer.read().value() == 1);
+    REQUIRE(buffer.tail_.load() == 1);
+  }
+
+  SECTION("Overwrite") {
+    LazyBuffer<std::string, 4> buffer;
+    buffer.publish_every(4);
+    for(int i = 1; i <= 4; i++) {
+      REQUIRE(buffer.write(std::to_string(i)));
+    }
+
+    REQUIRE(buffer.read().value() == "1");
+    REQUIRE(buffer.tail_.load() == 0);  /// read, but not published
+
+    buffer.overwrite("5");              /// takes the slot 1 was read from
+    buffer.overwrite("6");              /// now it's full, 2 goes
+    buffer.flush();
+    for(const auto* expected : { "3", "4", "5", "6" }) {
+      REQUIRE(buffer.read().value() == expected);
+    }
+    REQUIRE(!buffer.read().has_value());
+  }
+}
+
+TEST_CASE("BasicFunctionality", "[PriorityRingQueue]") {
+  PriorityRingQueue<int, 4, 3> queue;
+  REQUIRE(queue.is_empty());
+  REQUIRE(!queue.try_dequeue().has_value());
+
+  REQUIRE(queue.try_enqueue(2, 20));
+  REQUIRE(queue.try_enqueue(2, 21));
+  REQUIRE(queue.try_enqueue(1, 10));
+  REQUIRE(queue.ready_mask_.load() == 0b110);
+
+  REQUIRE(queue.try_dequeue().value() == 10);
+  queue.enqueue(0, 0);                      /// overtakes lane 2
+  REQUIRE(queue.try_dequeue().value() == 0);
+  REQUIRE(queue.try_dequeue().value() == 20);
+  REQUIRE(queue.dequeue() == 21);
+  REQUIRE(queue.ready_mask_.load() == 0b100);
+
+  REQUIRE(!queue.try_dequeue().has_value());
+  REQUIRE(queue.ready_mask_.load() == 0);
+  REQUIRE(queue.is_empty());
+
+  for(int i = 0; i < 4; i++) {
+    REQUIRE(queue.try_enqueue(1, i));
+  }
+  REQUIRE(!queue.try_enqueue(1, 4));
+}
+
+TEST_CASE("SingleNotify", "[PriorityRingQueue]") {
+  PriorityRingQueue<int, 4, 2, NotifyCounter> queue;
+  REQUIRE(queue.try_enqueue(0, 1));
+  queue.enqueue(1, 2);
+  REQUIRE(queue.ready_.notified_ == 2);
+  REQUIRE(queue.lane(0).consumer_wait().notified_ == 0);
+  REQUIRE(queue.lane(1).consumer_wait().notified_ == 0);
+  REQUIRE(queue.dequeue() == 1);
+  REQUIRE(queue.dequeue() == 2);
+}
+
+TEST_CASE("Concurrent", "[PriorityRingQueue]") {
+  constexpr size_t lanes = 3;
+  constexpr int count = 50000;
+  PriorityRingQueue<int, 32, lanes> queue;
+  int next[ lanes ]{};
+  bool in_order = true;
+
+  std::thread consumer([&]() {
+    for(size_t i = 0; i < lanes * count; i++) {
+      const int val  = queue.dequeue();
+      const int lane = val / count;
+      in_order = val % count == next[lane]++ && in_order;
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for(size_t lane = 0; lane < lanes; lane++) {
+    producers.emplace_back([&, lane]() {
+      for(int i = 0; i < count; i++) {
+        queue.enqueue(lane, static_cast<int>(lane) * count + i);
+      }
+    });
+  }
+
+  for(auto& thread : producers) {
+    thread.join();
+  }
+
+  consumer.join();
+  REQUIRE(in_order);
+  REQUIRE(queue.is_empty());
+  for(const int seen : next) {
+    REQUIRE(seen == count);
+  }
+}
+
+TEST_CASE("EventFd", "[RingQueue]") {
+  SECTION("Transitions") {
+    RingQueue<int, 8, EventFdWait> queue;
+    auto& wait = queue.consumer_wait();
+    pollfd pfd{ wait.fd(), POLLIN, 0 };
+    REQUIRE(::poll(&pfd, 1, 0) == 0);
+
+    for(int i = 0; i < 3; i++) {
+      queue.enqueue(i);
+    }
+
+    uint64_t count = 0;
+    REQUIRE(::read(wait.fd(), &count, sizeof(count)) == sizeof(count));
+    REQUIRE(count == 1);              /// once, not per element
+
+    queue.enqueue(3);                 /// not re-armed yet
+    REQUIRE(::poll(&pfd, 1, 0) == 0);
+
+    wait.reset();
+    queue.enqueue(4);
+    REQUIRE(::poll(&pfd, 1, 0) == 1);
+    REQUIRE(queue.dequeue() == 0);
+
+    RingQueue<int, 8, EventFdWait> empty;
+    REQUIRE(empty.dequeue_for(std::chrono::milliseconds{ 5 }).error() == RingStatus::timeout);
+  }
+
+  SECTION("Epoll") {
+    constexpr int count = 100000;
+    constexpr int rings = 2;
+    RingQueue<int, 64, EventFdWait> queues[ rings ];
+
+    const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    REQUIRE(epfd >= 0);
+    for(int i = 0; i < rings; i++) {
+      epoll_event ev{};
+      ev.events  = EPOLLIN;
+      ev.data.u32 = static_cast<uint32_t>(i);
+      REQUIRE(::epoll_ctl(epfd, EPOLL_CTL_ADD, queues[i].consumer_wait().fd(), &ev) == 0);
+    }
+
+    std::vector<std::thread> producers;
+    for(int i = 0; i < rings; i++) {
+      producers.emplace_back([&, i]() {
+        for(int j = 0; j < count; j++) {
+          queues[i].enqueue(j);
+        }
+      });
+    }
+
+    int next[ rings ]{};
+    bool in_order = true;
+    while(next[0] < count || next[1] < count) {
+      epoll_event events[ rings ];
+      const int ready = ::epoll_wait(epfd, events, rings, 1000);
+      REQUIRE(ready > 0);
+
+      for(int e = 0; e < ready; e++) {
+        const auto id = events[e].data.u32;
+        queues[id].consumer_wait().reset();
+        while(auto val = queues[id].try_dequeue()) {
+          in_order = *val == next[id]++ && in_order;
+        }
+      }
+    }
+
+    for(auto& thread : producers) {
+      thread.join();
+    }
+
+    ::close(epfd);
+    REQUIRE(in_order);
+  }
+}
+
+TEST_CASE("Buckets", "[Latency]") {
+  for(uint64_t val : { 0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, ~0ull }) {
+    const size_t idx = LatencyBuckets::index(val);
+    REQUIRE(idx < LatencyBuckets::count_);
+    REQUIRE(LatencyBuckets::highest(idx) >= val);
+    REQUIRE(LatencyBuckets::highest(idx) - val <= val / LatencyBuckets::sub_buckets_);
+    REQUIRE(LatencyBuckets::index(LatencyBuckets::highest(idx)) == idx);
+  }
+
+  LatencyHistogram hist;
+  for(uint64_t val = 1; val <= 100; val++) {
+    hist.record(val * 100);
+  }
+
+  const auto snap = hist.snapshot();
+  REQUIRE(snap.total == 100);
+  REQUIRE(snap.max == 10000);
+  REQUIRE(snap.mean() == 5050.0);
+  REQUIRE(snap.percentile(0.0) == 103);              /// 100's bucket
+  REQUIRE(snap.percentile(1.0) == 10000);
+  REQUIRE(snap.percentile(0.5) >= 5000);
+  REQUIRE(snap.percentile(0.5) <= 5000 + 5000 / 16);
+}
+
+TEST_CASE("BasicFunctionality", "[TracedRingQueue]") {
+  TracedRingQueue<std::string, 4> queue;
+  REQUIRE(queue.latency().total == 0);
+  REQUIRE(!queue.try_dequeue().has_value());
+
+  queue.enqueue(3, 'a');
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+  REQUIRE(queue.try_enqueue("b"));
+  REQUIRE(queue.dequeue() == "aaa");
+  REQUIRE(queue.try_dequeue().value() == "b");
+  REQUIRE(queue.dequeue_for(std::chrono::milliseconds{ 1 }).error() == RingStatus::timeout);
+
+  const auto snap = queue.latency();
+  REQUIRE(snap.total == 2);
+  REQUIRE(LatencySnapshot::to_nanos(snap.max) >= std::chrono::milliseconds{ 1 });
+  REQUIRE(snap.percentile(0.0) < snap.max);
+}
+
+TEST_CASE("Concurrent", "[TracedRingQueue]") {
+  constexpr int count = 100000;
+  TracedRingQueue<int, 64> queue;
+  bool in_order = true;
+
+  std::thread consumer([&]() {
+    for(int i = 0; i < count; i++) {
+      in_order = queue.dequeue() == i && in_order;
+    }
+  });
+
+  for(int i = 0; i < count; i++) {
+    queue.enqueue(i);
+    if(i % 1000 == 0) {
+      REQUIRE(queue.latency().total <= static_cast<uint64_t>(i) + 1);  /// readable mid-flight
+    }
+  }
+
+  consumer.join();
+  REQUIRE(in_order);
+  REQUIRE(queue.latency().total == count);
+}
+
+TEST_CASE("SurvivesCrash", "[MappedRing]") {
+  using Recorder = MappedRing<RingBuffer<int, 8>>;
+  const std::string path = "/tmp/rb-test-" + std::to_string(::getpid()) + ".ring";
+
+  auto created = Recorder::create(path);
+  REQUIRE(created.has_value());
+  REQUIRE((*created)->is_empty());
+
+  const pid_t child = ::fork();
+  REQUIRE(child >= 0);
+  if(child == 0) {
+    auto recorder = Recorder::open(path);
+    if(!recorder)
+      ::_exit(1);
+    for(int i = 0; i < 20; i++) {
+      (*recorder)->overwrite(i);
+    }
+    ::kill(::getpid(), SIGKILL);  /// no unmapping, no destructors
+  }
+
+  int status = 0;
+  REQUIRE(::waitpid(child, &status, 0) == child);
+  REQUIRE(WIFSIGNALED(status));
+
+  for(int pass = 0; pass < 2; pass++) {     /// snapshots leave the file alone
+    auto snapshot = Recorder::open(path, MapMode::snapshot);
+    REQUIRE(snapshot.has_value());
+    std::vector<int> events;
+    while(auto val = (*snapshot)->read()) {
+      events.push_back(*val);
+    }
+    REQUIRE(events == std::vector<int>{ 12, 13, 14, 15, 16, 17, 18, 19 });
+  }
+
+  REQUIRE(MappedRing<RingBuffer<int, 16>>::open(path).error() == std::errc::invalid_argument);
+  REQUIRE(MappedRing<RingBuffer<long, 8>>::open(path).error() == std::errc::invalid_argument);
+  REQUIRE(Recorder::open(path + ".missing").error() == std::errc::no_such_file_or_directory);
+
+  REQUIRE(!created->sync(true));
+  created->sync_every(std::chrono::milliseconds{ 1 });
+  (*created)->overwrite(20);
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+
+  Recorder moved{ std::move(*created) };     /// the syncer moves along
+  moved.sync_every(std::chrono::milliseconds{ 0 });
+  REQUIRE(moved->try_current().value() == 13);
+  REQUIRE(::unlink(path.c_str()) == 0);
+}
+
+namespace {
+  struct EagerTraits : RingTraits<8> {
+    constexpr static size_t publish_batch_ = 1;
+  };
+
+  struct BatchedTraits : RingTraits<8, YieldWait, CacheLineLayout, RingStats> {
+    constexpr static size_t publish_batch_ = 4;
+  };
+
+  struct RuntimeTraits : RingTraits<4> {
+    constexpr static size_t publish_batch_ = runtime_batch;
+  };
+}
+
+TEST_CASE("Traits", "[RingTraits]") {
+  static_assert(std::same_as<RingQueueFor<int, RingTraits<8>>, RingQueue<int, 8>>);
+  static_assert(std::same_as<RingBufferFor<int, RingTraits<8>>, RingBuffer<int, 8>>);
+  static_assert(std::same_as<RingQueueFor<int, BatchedTraits>::WaitType, YieldWait>);
+
+  SECTION("Eager") {
+    RingQueueFor<int, EagerTraits> queue;
+    static_assert(!RuntimeBatch<decltype(queue)>);
+    static_assert(!RuntimeBatch<RingQueue<int, 8>>);   /// eager by default
+    static_assert(RuntimeBatch<RingQueueFor<int, RuntimeTraits>>);
+    queue.enqueue(1);
+    REQUIRE(queue.head_.load() == 1);
+    REQUIRE(queue.head_pending_ == 0);
+    REQUIRE(queue.dequeue() == 1);
+    REQUIRE(queue.tail_.load() == 1);
+  }
+
+  SECTION("Batched") {
+    RingQueueFor<int, BatchedTraits> queue;
+    for(int i = 0; i < 3; i++) {
+      REQUIRE(queue.try_enqueue(i));
+    }
+    REQUIRE(queue.head_.load() == 0);
+    REQUIRE(queue.try_enqueue(3));
+    REQUIRE(queue.head_.load() == 4);
+    REQUIRE(queue.dequeue() == 0);
+    REQUIRE(queue.stats().enqueued == 4);
+  }
+
+  SECTION("Runtime") {
+    RingBufferFor<int, RuntimeTraits> buffer;
+    buffer.publish_every(2);
+    REQUIRE(buffer.write(1));
+    REQUIRE(buffer.head_.load() == 0);
+    REQUIRE(buffer.write(2));
+    REQUIRE(buffer.read().value() == 1);
+  }
+}
+
+TEST_CASE("Placement", "[Numa]") {
+  const int node = std::max(current_node(), 0);
+  REQUIRE(node_of_cpu(0) >= -1);
+
+  SECTION("DynamicSlots") {
+    RingQueue<int, dynamic_extent> queue{ 1000, StorageOptions{ .numa_node = node } };
+    REQUIRE(queue.capacity() == 1024);
+    for(int i = 0; i < 1000; i++) {
+      queue.enqueue(i);
+    }
+    const int placed = node_of(queue.data());
+    REQUIRE((placed == node || placed == -1));  /// -1 without NUMA support
+    REQUIRE(queue.dequeue() == 0);
+  }
+
+  SECTION("Between") {
+    using Queue = RingQueue<int, 256, BlockingWait, PageLayout>;
+    auto queue = make_between<Queue>(Placement{ node, node });
+    REQUIRE(queue.placement().consumer_node == node);
+    REQUIRE(reinterpret_cast<uintptr_t>(&*queue) % 4096 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(&queue->tail_) - reinterpret_cast<uintptr_t>(&queue->head_) == 4096);
+
+    constexpr int count = 20000;
+    bool in_order = true;
+    std::thread consumer([&]() {
+      for(int i = 0; i < count; i++) {
+        in_order = queue->dequeue() == i && in_order;
+      }
+    });
+
+    for(int i = 0; i < count; i++) {
+      queue->enqueue(i);
+    }
+
+    consumer.join();
+    REQUIRE(in_order);
+
+    auto dynamic = make_between<RingBuffer<std::string, dynamic_extent>>(Placement::between_cpus(0, 0), 16);
+    REQUIRE(dynamic->write("left behind"));   /// destroyed with the ring
+    REQUIRE(dynamic->capacity() == 16);
+  }
+
+  SECTION("SharedPages") {
+    /// head_ doesn't start a page here, so the producer's fields
+    /// stay with the rest, whatever node they were asked for.
+    auto queue = make_between<RingQueue<int, 256>>(Placement{ node + 1, node });
+    REQUIRE(reinterpret_cast<uintptr_t>(&queue->head_) % 4096 != 0);
+    queue->enqueue(7);
+    const int placed = node_of(&queue->head_);
+    REQUIRE((placed == node || placed == -1));
+    REQUIRE(queue->dequeue() == 7);
+  }
+}